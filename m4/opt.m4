@@ -26,4 +26,21 @@ AC_DEFUN([AC_FLDIGI_OPT], [
   esac
 
   AC_SUBST([OPT_CFLAGS])
+
+  AC_ARG_ENABLE([mt63-float],
+                AC_HELP_STRING([--enable-mt63-float],
+                               [use the float MT63 receiver kernels (yes|no|auto) @<:@auto@:>@]),
+                [case "${enableval}" in
+                  yes|no|auto) ac_cv_mt63_float="${enableval}" ;;
+                  *)           AC_MSG_ERROR([bad value ${enableval} for --enable-mt63-float]) ;;
+                 esac],
+                 [ac_cv_mt63_float=auto])
+  case "$ac_cv_mt63_float" in
+      yes)
+          AC_DEFINE(MT63_FLOAT_SIMD, 1, [Defined to 1 to use the float MT63 kernels, 0 for the double ones])
+          ;;
+      no)
+          AC_DEFINE(MT63_FLOAT_SIMD, 0, [Defined to 1 to use the float MT63 kernels, 0 for the double ones])
+          ;;
+  esac
 ])
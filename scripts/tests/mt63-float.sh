@@ -0,0 +1,13 @@
+#!/bin/sh
+
+# Check that the MT63 float receiver kernels do not decode worse than the
+# double ones, see --benchmark-kernel mt63.  Needs --enable-benchmark.
+
+test -x ./dl-fldigi || exit 77
+
+dir=$(mktemp -d "${TMPDIR:-/tmp}/mt63-float.XXXXXX") || exit 1
+./dl-fldigi --config-dir "$dir" --benchmark-kernel mt63
+r=$?
+rm -rf "$dir"
+
+exit $r
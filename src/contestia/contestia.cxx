@@ -234,11 +234,14 @@ int contestia::rx_process(const double *buf, int len)
 		clamp(progStatus.sldrSquelchValue / 5.0 + 3.0, 3.0, 90.0) : 3.0;
 
     Rx->Process(buf, len);
-	sp = 0;
-	for (int i = frequency - Rx->Bandwidth/2; i < frequency - 1 + Rx->Bandwidth/2; i++)
-		if (wf->Pwr(i) > sp)
-			sp = wf->Pwr(i);
-	np = wf->Pwr(frequency + Rx->Bandwidth/2 + 2*Rx->Bandwidth/Rx->Tones);
+	for (;;) {
+		spectrum::snapshot s(*wf->powerSpectrum());
+		sp = s.peak(static_cast<int>(frequency - Rx->Bandwidth/2),
+			    static_cast<int>(ceil(frequency - 1 + Rx->Bandwidth/2)) - 1);
+		np = s.power(frequency + Rx->Bandwidth/2 + 2*Rx->Bandwidth/Rx->Tones);
+		if (s.valid())
+			break;
+	}
 	if (np == 0) np = sp + 1e-8;
 	sigpwr = decayavg( sigpwr, sp, 10);
 	noisepwr = decayavg( noisepwr, np, 50);
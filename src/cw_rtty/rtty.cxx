@@ -121,8 +121,8 @@ void rtty::rx_init()
 
 	lost = 0;
 
-	mark_phase = 0;
-	space_phase = 0;
+	mark_nco = space_nco = cmplx(1.0, 0.0);
+	nco_freq = nco_shift = -1.0;
 	xy_phase = 0.0;
 
 	mark_mag = 0;
@@ -194,7 +194,7 @@ rtty::~rtty()
 void rtty::reset_filters()
 {
     printf("reseting Filter for Baud %f, %f\n", rtty_baud, samplerate);  // print dot length
-	int filter_length = 1024;
+	int filter_length = RTTY_FILTLEN;
 
     
         if (mark_filt) {
@@ -288,8 +288,8 @@ void rtty::restart()
 	m_SymShaper1->Preset(rtty_baud, samplerate);
 	m_SymShaper2->Preset(rtty_baud, samplerate);
 
-	mark_phase = 0;
-	space_phase = 0;
+	mark_nco = space_nco = cmplx(1.0, 0.0);
+	nco_freq = nco_shift = -1.0;
 	xy_phase = 0.0;
 
 	mark_mag = 0;
@@ -350,16 +350,6 @@ void rtty::Clear_syncscope()
 	set_scope(0, 0, false);
 }
 
-cmplx rtty::mixer(double &phase, double f, cmplx in)
-{
-	cmplx z = cmplx( cos(phase), sin(phase)) * in;
-
-	phase -= TWOPI * f / samplerate;
-	if (phase < -TWOPI) phase += TWOPI;
-
-	return z;
-}
-
 unsigned char rtty::Bit_reverse(unsigned char in, int n)
 {
 	unsigned char out = 0;
@@ -534,10 +524,16 @@ char snrmsg[80];
 void rtty::Metric()
 {
 	double delta = rtty_baud/8.0;
-	double np = wf->powerDensity(frequency, delta) * 3000 / delta;
-	double sp =
-		wf->powerDensity(frequency - shift/2, delta) +
-		wf->powerDensity(frequency + shift/2, delta) + 1e-10;
+	double np, sp;
+	for (;;) {
+		spectrum::snapshot s(*wf->powerSpectrum());
+		np = s.density(frequency, delta) * 3000 / delta;
+		sp =
+			s.density(frequency - shift/2, delta) +
+			s.density(frequency + shift/2, delta) + 1e-10;
+		if (s.valid())
+			break;
+	}
 	double snr = 0;
 
 	sigpwr = decayavg( sigpwr, sp, sp > sigpwr ? 2 : 8);
@@ -550,41 +546,51 @@ void rtty::Metric()
 	display_metric(metric);
 }
 
+// Both searches read one spectrum frame, as Metric does, and start again if
+// the waterfall reused it before the search was over.
 void rtty::searchDown()
 {
-	double srchfreq = frequency - shift -100;
 	double minfreq = shift * 2 + 100;
-	double spwrlo, spwrhi, npwr;
-	while (srchfreq > minfreq) {
-		spwrlo = wf->powerDensity(srchfreq - shift/2, 2*rtty_baud);
-		spwrhi = wf->powerDensity(srchfreq + shift/2, 2*rtty_baud);
-		npwr = wf->powerDensity(srchfreq + shift, 2*rtty_baud) + 1e-10;
-		if ((spwrlo / npwr > 10.0) && (spwrhi / npwr > 10.0)) {
-			frequency = srchfreq;
-			set_freq(frequency);
-			sigsearch = SIGSEARCH;
-			break;
+	double srchfreq;
+	for (;;) {
+		spectrum::snapshot s(*wf->powerSpectrum());
+		for (srchfreq = frequency - shift - 100; srchfreq > minfreq; srchfreq -= 5.0) {
+			double spwrlo = s.density(srchfreq - shift/2, 2*rtty_baud);
+			double spwrhi = s.density(srchfreq + shift/2, 2*rtty_baud);
+			double npwr = s.density(srchfreq + shift, 2*rtty_baud) + 1e-10;
+			if ((spwrlo / npwr > 10.0) && (spwrhi / npwr > 10.0))
+				break;
 		}
-		srchfreq -= 5.0;
+		if (s.valid())
+			break;
+	}
+	if (srchfreq > minfreq) {
+		frequency = srchfreq;
+		set_freq(frequency);
+		sigsearch = SIGSEARCH;
 	}
 }
 
 void rtty::searchUp()
 {
-	double srchfreq = frequency + shift +100;
 	double maxfreq = IMAGE_WIDTH - shift * 2 - 100;
-	double spwrhi, spwrlo, npwr;
-	while (srchfreq < maxfreq) {
-		spwrlo = wf->powerDensity(srchfreq - shift/2, 2*rtty_baud);
-		spwrhi = wf->powerDensity(srchfreq + shift/2, 2*rtty_baud);
-		npwr = wf->powerDensity(srchfreq - shift, 2*rtty_baud) + 1e-10;
-		if ((spwrlo / npwr > 10.0) && (spwrhi / npwr > 10.0)) {
-			frequency = srchfreq;
-			set_freq(frequency);
-			sigsearch = SIGSEARCH;
-			break;
+	double srchfreq;
+	for (;;) {
+		spectrum::snapshot s(*wf->powerSpectrum());
+		for (srchfreq = frequency + shift + 100; srchfreq < maxfreq; srchfreq += 5.0) {
+			double spwrlo = s.density(srchfreq - shift/2, 2*rtty_baud);
+			double spwrhi = s.density(srchfreq + shift/2, 2*rtty_baud);
+			double npwr = s.density(srchfreq - shift, 2*rtty_baud) + 1e-10;
+			if ((spwrlo / npwr > 10.0) && (spwrhi / npwr > 10.0))
+				break;
 		}
-		srchfreq += 5.0;
+		if (s.valid())
+			break;
+	}
+	if (srchfreq < maxfreq) {
+		frequency = srchfreq;
+		set_freq(frequency);
+		sigsearch = SIGSEARCH;
 	}
 }
 
@@ -607,7 +613,7 @@ int rtty::rx_process(const double *buf, int len)
 	int length = len;
 	static int showxy = symbollen;
 
-	cmplx z, zmark, zspace, *zp_mark, *zp_space;
+	cmplx z, *zp_mark = mark_out, *zp_space = space_out;
 
 	int n_out = 0;
 	static int bitcount = 5 * nbits * symbollen;
@@ -625,10 +631,14 @@ int rtty::rx_process(const double *buf, int len)
 #if FILTER_DEBUG == 1
 double value;
 #endif
-	while (length-- > 0) {
+	while (length > 0) {
+		int n = mark_filt->run_length();
+		if (n > length) n = length;
+		length -= n;
 
 // Create analytic signal from sound card input samples
 
+		for (int j = 0; j < n; j++) {
 #if FILTER_DEBUG == 1
 if (snum < 2 * filter_length) {
 	frequency = 1000.0;
@@ -641,28 +651,48 @@ if (snum < 2 * filter_length) {
 	z = cmplx(*buffer, *buffer);
 }
 #else
-	z = cmplx(*buffer, *buffer);
+			z = cmplx(*buffer, *buffer);
 #endif
-	buffer++;
-
-// Mix it with the audio carrier frequency to create two baseband signals
-// mark and space are separated and processed independently
-// lowpass Windowed Sinc - Overlap-Add convolution filters.
-// The two fftfilt's are the same size and processed in sync
-// therefore the mark and space filters will concurrently have the
-// same size outputs available for further processing
-
-		zmark = mixer(mark_phase, frequency + shift/2.0, z);
-		mark_filt->run(zmark, &zp_mark);
-
-		zspace = mixer(space_phase, frequency - shift/2.0, z);
-		n_out = space_filt->run(zspace, &zp_space);
+			buffer++;
+			rx_in[j] = z;
 #if FILTER_DEBUG == 1
 if (snum < 2 * filter_length) {
-	ook_signal << abs(zmark) <<"\n";
+	ook_signal << abs(z) <<"\n";
 	snum++;
 }
 #endif
+		}
+
+// Mark and space are separated by lowpass Windowed Sinc - Overlap-Add
+// convolution filters moved up to the mark and space tones.  The two
+// fftfilt's are the same size and processed in sync, sharing the forward
+// FFT of the input, and have the same size outputs available for further
+// processing.  Mixing the outputs with the audio carrier frequency gives
+// the same two baseband signals as mixing the input and lowpass filtering.
+// The filters move by whole bins, the remaining fraction of a bin only
+// offsets the filter centre, the oscillators mix the exact tones.
+
+		if (frequency != nco_freq || shift != nco_shift) {
+			nco_freq = frequency;
+			nco_shift = shift;
+			mark_filt->shift_filter((frequency + shift/2.0) / samplerate);
+			space_filt->shift_filter((frequency - shift/2.0) / samplerate);
+			mark_rot = cmplx(cos(TWOPI * (frequency + shift/2.0) / samplerate),
+				-sin(TWOPI * (frequency + shift/2.0) / samplerate));
+			space_rot = cmplx(cos(TWOPI * (frequency - shift/2.0) / samplerate),
+				-sin(TWOPI * (frequency - shift/2.0) / samplerate));
+		}
+		n_out = mark_filt->run_pair(*space_filt, rx_in, n, mark_out, space_out);
+
+		for (int i = 0; i < n_out; i++) {
+			mark_out[i] *= mark_nco;
+			mark_nco *= mark_rot;
+			space_out[i] *= space_nco;
+			space_nco *= space_rot;
+		}
+		mark_nco /= abs(mark_nco);
+		space_nco /= abs(space_nco);
+
 		for (int i = 0; i < n_out; i++) {
 
 			mark_mag = abs(zp_mark[i]);
@@ -842,7 +872,8 @@ if (mnum < 2 * filter_length)
 					for (int i = 0; i < MAXPIPE; i++) QI[i].real() = QI[i].imag() = 0.0;
 				}
 			}
-			if (!--showxy) {
+			showxy -= n;
+			if (showxy <= 0) {
 				set_zdata(QI, MAXPIPE);
 				showxy = symbollen;
 			}
@@ -72,8 +72,6 @@ void view_rtty::rx_init()
 		channel[ch].frequency = NULLFREQ;
 		channel[ch].poserr = channel[ch].negerr = 0.0;
 
-		channel[ch].mark_phase = 0;
-		channel[ch].space_phase = 0;
 		channel[ch].mark_mag = 0;
 		channel[ch].space_mag = 0;
 		channel[ch].mark_env = 0;
@@ -97,28 +95,16 @@ void view_rtty::init()
 
 view_rtty::~view_rtty()
 {
-	for (int ch = 0; ch < MAX_CHANNELS; ch ++) {
-		if (channel[ch].mark_filt) delete channel[ch].mark_filt;
-		if (channel[ch].space_filt) delete channel[ch].space_filt;
-	}
+	if (channelizer) delete channelizer;
 }
 
-void view_rtty::reset_filters(int ch)
+void view_rtty::reset_filters()
 {
 	int filter_length = 1024;
-	if (channel[ch].mark_filt) {
-		channel[ch].mark_filt->rtty_filter(rtty_baud/samplerate);
-	} else {
-		channel[ch].mark_filt = new fftfilt(rtty_baud/samplerate, filter_length);
-		channel[ch].mark_filt->rtty_filter(rtty_baud/samplerate);
-	}
-
-	if (channel[ch].space_filt) {
-		channel[ch].space_filt->rtty_filter(rtty_baud/samplerate);
-	} else {
-		channel[ch].space_filt = new fftfilt(rtty_baud/samplerate, filter_length);
-		channel[ch].space_filt->rtty_filter(rtty_baud/samplerate);
-	}
+	if (!channelizer)
+		channelizer = new fftchannelizer(rtty_baud/samplerate, filter_length,
+						2 * MAX_CHANNELS, samplerate);
+	channelizer->rtty_filter(rtty_baud/samplerate);
 }
 
 void view_rtty::restart()
@@ -154,9 +140,9 @@ void view_rtty::restart()
 	if (bp_filt_lo < 0) bp_filt_lo = 0;
 	bp_filt_hi = (shift/2.0 + rtty_BW/2.0) / samplerate;
 
-	for (int ch = 0; ch < MAX_CHANNELS; ch ++) {
+	reset_filters();
 
-		reset_filters(ch);
+	for (int ch = 0; ch < MAX_CHANNELS; ch ++) {
 
 		channel[ch].state = IDLE;
 		channel[ch].timeout = 0;
@@ -167,8 +153,6 @@ void view_rtty::restart()
 		channel[ch].sigsearch = 0;
 		channel[ch].frequency = NULLFREQ;
 		channel[ch].counter = symbollen / 2;
-		channel[ch].mark_phase = 0;
-		channel[ch].space_phase = 0;
 		channel[ch].mark_mag = 0;
 		channel[ch].space_mag = 0;
 		channel[ch].mark_env = 0;
@@ -207,25 +191,13 @@ view_rtty::view_rtty(trx_mode tty_mode)
 
 	samplerate = RTTY_SampleRate;
 
-	for (int ch = 0; ch < MAX_CHANNELS; ch ++) {
-		channel[ch].mark_filt = (fftfilt *)0;
-		channel[ch].space_filt = (fftfilt *)0;
+	channelizer = (fftchannelizer *)0;
+	for (int ch = 0; ch < MAX_CHANNELS; ch ++)
 		channel[ch].bits = (Cmovavg *)0;
-	}
 
 	restart();
 }
 
-cmplx view_rtty::mixer(double &phase, double f, cmplx in)
-{
-	cmplx z = cmplx( cos(phase), sin(phase)) * in;;
-
-	phase -= TWOPI * f / samplerate;
-	if (phase < - TWOPI) phase += TWOPI;
-
-	return z;
-}
-
 
 unsigned char view_rtty::bitreverse(unsigned char in, int n)
 {
@@ -455,7 +427,7 @@ void view_rtty::clear()
 
 int view_rtty::rx_process(const double *buf, int buflen)
 {
-	cmplx z, zmark, zspace, *zp_mark, *zp_space;
+	cmplx *zp_mark, *zp_space;
 	static bool bit = true;
 	int n = 0;
 
@@ -469,18 +441,28 @@ int view_rtty::rx_process(const double *buf, int buflen)
 			if (!channel[ch].sigsearch)
 				channel[ch].state = RCVNG;
 		}
+	}
 
-		for (int len = 0; len < buflen; len++) {
-			z = cmplx(buf[len], buf[len]);
+	for (int len = 0; len < buflen; len++) {
+// one input spectrum per block is shared by all of the channels
+		if (!channelizer->collect(cmplx(buf[len], buf[len])))
+			continue;
 
-			zmark = mixer(channel[ch].mark_phase, channel[ch].frequency + shift/2.0, z);
-			channel[ch].mark_filt->run(zmark, &zp_mark);
+		for (int ch = 0; ch < progdefaults.VIEWERchannels; ch++) {
+			if (channel[ch].state == IDLE) {
+				channelizer->reset_tone(2 * ch);
+				channelizer->reset_tone(2 * ch + 1);
+				continue;
+			}
 
-			zspace = mixer(channel[ch].space_phase, channel[ch].frequency - shift/2.0, z);
-			n = channel[ch].space_filt->run(zspace, &zp_space);
+			zp_mark = channelizer->run_tone(2 * ch, channel[ch].frequency + shift/2.0);
+			zp_space = channelizer->run_tone(2 * ch + 1, channel[ch].frequency - shift/2.0);
+			if (!zp_mark || !zp_space)
+				continue;
+			n = channelizer->run_length();
 
 // n loop
-			if (n) Metric(ch);
+			Metric(ch);
 
 			for (int i = 0; i < n; i++) {
 
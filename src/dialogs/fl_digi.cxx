@@ -41,6 +41,7 @@
 #include <fstream>
 #include <algorithm>
 #include <map>
+#include <vector>
 
 #ifndef __WOE32__
 #include <sys/wait.h>
@@ -6869,8 +6870,25 @@ void add_tx_char(int data)
 }
 
 //======================================================================
+// received text that has not been added to ReceiveText yet, all with
+// the same style
+static string rx_display_text;
+static int rx_display_style = FTextBase::RECV;
+
+static void flush_rx_data(void)
+{
+	if (!rx_display_text.empty()) {
+		ReceiveText->add(rx_display_text.data(), rx_display_text.length(), rx_display_style);
+		rx_display_text.clear();
+	}
+}
+
 static void display_rx_data(const unsigned char data, int style) {
-	ReceiveText->add(data, style);
+	if (style != rx_display_style) {
+		flush_rx_data();
+		rx_display_style = style;
+	}
+	rx_display_text += data;
 
 	if (bWF_only) return;
 
@@ -6915,8 +6933,10 @@ static void rx_parser(const unsigned char data, int style)
 
 	lastdata = data;
 
+	// The spotter callbacks may add to ReceiveText, so the text is added
+	// before a callback is made.
 	if (!(data < ' ' && iscntrl(data)) && progStatus.spot_recv)
-		spot_recv(data);
+		spot_recv(data, -1, 0, 0, flush_rx_data);
 }
 
 
@@ -6962,10 +6982,34 @@ static void put_rx_char_flmain(unsigned int data, int style)
 	}
 }
 
+// Received characters wait here for the main thread, which takes all of
+// them in one request and adds them to ReceiveText together.  A request
+// is only made when none is pending, or when the last one was lost to a
+// full queue.
+static pthread_mutex_t rx_queue_mutex = PTHREAD_MUTEX_INITIALIZER;
+static vector<pair<unsigned int, int> > rx_queue;
+static bool rx_queue_posted = false;
+
+static void put_rx_queue_flmain(void)
+{
+	ENSURE_THREAD(FLMAIN_TID);
+
+	vector<pair<unsigned int, int> > q;
+	{
+		guard_lock lock(&rx_queue_mutex);
+		q.swap(rx_queue);
+		rx_queue_posted = false;
+	}
+
+	for (size_t i = 0; i < q.size(); i++)
+		put_rx_char_flmain(q[i].first, q[i].second);
+	flush_rx_data();
+}
+
 void put_rx_char(unsigned int data, int style, bool extracted)
 {
 #if BENCHMARK_MODE
-	if (!benchmark.output.empty()) {
+	if (!benchmark.output.empty() || !benchmark.json.empty()) {
 		if (unlikely(benchmark.buffer.length() + 16 > benchmark.buffer.capacity()))
 			benchmark.buffer.reserve(benchmark.buffer.capacity() + BUFSIZ);
 		benchmark.buffer += (char)data;
@@ -6974,7 +7018,22 @@ void put_rx_char(unsigned int data, int style, bool extracted)
 	if (progdefaults.autoextract == true)
 		rx_extract_add(data);
 	WriteARQ(data);
-	REQ(put_rx_char_flmain, data, style);
+
+	bool post;
+	{
+		guard_lock lock(&rx_queue_mutex);
+		rx_queue.push_back(make_pair(data, style));
+		post = !rx_queue_posted;
+		rx_queue_posted = true;
+	}
+	if (post) {
+		if (GET_THREAD_ID() == FLMAIN_TID)
+			put_rx_queue_flmain();
+		else if (!cbq[GET_THREAD_ID()]->request(qrbind::bind(put_rx_queue_flmain))) {
+			guard_lock lock(&rx_queue_mutex);
+			rx_queue_posted = false;
+		}
+	}
 #endif
 
     if (!extracted)
@@ -6983,9 +7042,11 @@ void put_rx_char(unsigned int data, int style, bool extracted)
     }
 }
 
-static void put_rx_ssdv_flmain(unsigned int data, int lost)
+// The bytes are queued for the SSDV decoder thread, which posts each
+// decoded packet to the main thread
+void put_rx_ssdv(unsigned int data, int lost)
 {
-	ENSURE_THREAD(FLMAIN_TID);
+	ENSURE_THREAD(TRX_TID);
 
 	if (ssdv)
 	{
@@ -6993,11 +7054,6 @@ static void put_rx_ssdv_flmain(unsigned int data, int lost)
 	}
 }
 
-void put_rx_ssdv(unsigned int data, int lost)
-{
-	REQ(put_rx_ssdv_flmain, data, lost);
-}
-
 static string strSecText = "";
 
 static void put_sec_char_flmain(char chr)
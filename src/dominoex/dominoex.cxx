@@ -117,6 +117,9 @@ void dominoex::reset_filters()
 	for (int i = 0; i < paths; i++)//MAXFFTS; i++)
 		binsfft[i] = new sfft (symlen, lotone, hitone);
 
+	for (int i = 0; i < CWITESTS; i++)
+		cwivalid[i] = false;
+
 	filter_reset = false;
 }
 
@@ -296,6 +299,7 @@ dominoex::dominoex(trx_mode md)
 	videodata.alloc(MAXFFTS * numbins);
 
 	pipeptr = 0;
+	pipepass = 0;
 
 	symcounter = 0;
 	Mu_symcounter = 0;
@@ -409,37 +413,61 @@ void dominoex::decodesymbol()
 	decodeMuPskEX(c);
 }
 
+// magnitudes of the bins of the current symbol, taken once for the symbol
+// decision, the sync scope and the s/n estimate
+void dominoex::binmags()
+{
+	const cmplx *v = pipe[pipeptr].vector;
+	for (int i = 0; i < paths * numbins; i++)
+		binmag[i] = abs(v[i]);
+}
+
+// magnitudes of the bins of pipe[j], they only change when the pipe
+// entry is rewritten, once every second symbol
+const double *dominoex::cwimags(int j)
+{
+	unsigned int pass = (unsigned int)j <= pipeptr ? pipepass : pipepass - 1;
+	double *mag = cwimag[j - 1];
+
+	if (!cwivalid[j - 1] || cwipass[j - 1] != pass) {
+		const cmplx *v = pipe[j].vector;
+		for (int i = 0; i < paths * numbins; i++)
+			mag[i] = abs(v[i]);
+		cwipass[j - 1] = pass;
+		cwivalid[j - 1] = true;
+	}
+	return mag;
+}
+
 int dominoex::harddecode()
 {
 	double x, max = 0.0;
 	int symbol = 0;
 	double avg = 0.0;
 	bool cwi[paths * numbins];
-	double cwmag;
+	const double *cwmag[CWITESTS];
 
 	for (int i = 0; i < paths * numbins; i++)
-		avg += abs(pipe[pipeptr].vector[i]);
+		avg += binmag[i];
 	avg /= (paths * numbins);
 
 	if (avg < 1e-10) avg = 1e-10;
 
-	int numtests = 10;
-	int count = 0;
+	int numtests = CWITESTS;
+	double cwlevel = 50.0 * (1.0 - progdefaults.ThorCWI) * avg;
+	for (int j = 1; j <= numtests; j++)
+		cwmag[j - 1] = cwimags(j);
+// a bin is CWI when it is strong in all of the tested pipe entries
 	for (int i = 0; i < paths * numbins; i++) {
-		cwmag = 0.0;
-		count = 0;
-		for (int j = 1; j <= numtests; j++) {
-			int p = pipeptr - j;
-			if (p < 0) p += twosym;
-			cwmag = abs(pipe[j].vector[i])/numtests;
-			if (cwmag >= 50.0 * (1.0 - progdefaults.ThorCWI) * avg) count++;
-		}
-		cwi[i] = (count == numtests);
+		int j = 0;
+		while (j < numtests && cwmag[j][i] / numtests >= cwlevel)
+			j++;
+		cwi[i] = (j == numtests);
 	}
 
 	for (int i = 0; i <  (paths * numbins); i++) {
 		if (cwi[i] == false) {
-			x = abs(pipe[pipeptr].vector[i]);
+			x = binmag[i];
 			avg += x;
 			if (x > max) {
 				max = x;
@@ -463,14 +491,14 @@ void dominoex::update_syncscope()
 
 	if (!progStatus.sqlonoff || metric >= progStatus.sldrSquelchValue) {
 		for (int i = 0; i < (paths * numbins); i++ ) {
-			mag = abs(pipe[pipeptr].vector[i]);
+			mag = binmag[i];
 			if (max < mag) max = mag;
 			if (min > mag) min = mag;
 		}
 		range = max - min;
 		for (int i = 0; i < (paths * numbins); i++ ) {
 			if (range > 2) {
-				mag = (abs(pipe[pipeptr].vector[i]) - min) / range + 0.0001;
+				mag = (binmag[i] - min) / range + 0.0001;
 				mag = 1 + 2 * log10(mag);
 				if (mag < 0) mag = 0;
 			} else
@@ -526,7 +554,7 @@ void dominoex::synchronize()
 
 void dominoex::eval_s2n()
 {
-	double s = abs(pipe[pipeptr].vector[currsymbol]);
+	double s = binmag[currsymbol];
 	double n = (NUMTONES - 1 ) * abs(pipe[(pipeptr + symlen) % twosym].vector[currsymbol]);
 
 	sig = decayavg( sig, s, abs( s - sig) > 4 ? 4 : 32);
@@ -592,6 +620,7 @@ int dominoex::rx_process(const double *buf, int len)
 				}
 				if (--synccounter <= 0) {
 					synccounter = symlen;
+					binmags();
 					currsymbol = harddecode();
 					decodesymbol();
 					synchronize();
@@ -601,8 +630,10 @@ int dominoex::rx_process(const double *buf, int len)
 					prev1symbol = currsymbol;
 				}
 				pipeptr++;
-				if (pipeptr >= twosym)
+				if (pipeptr >= twosym) {
 					pipeptr = 0;
+					pipepass++;
+				}
 			}
 		}
 		--len;
@@ -61,18 +61,26 @@ void fftfilt::init_filter()
 	filter		= new cmplx[flen];
 	timedata	= new cmplx[flen];
 	freqdata	= new cmplx[flen];
-	output		= new cmplx[flen];
-	ovlbuf		= new cmplx[flen2];
-	ht			= new cmplx[flen];
+	output		= 0;
+	ovlbuf		= 0;
 
 	memset(filter, 0, flen * sizeof(cmplx));
 	memset(timedata, 0, flen * sizeof(cmplx));
 	memset(freqdata, 0, flen * sizeof(cmplx));
-	memset(output, 0, flen * sizeof(cmplx));
-	memset(ovlbuf, 0, flen2 * sizeof(cmplx));
-	memset(ht, 0, flen * sizeof(cmplx));
 
 	inptr = 0;
+	fbin = 0;
+}
+
+// overlap-add and output buffers of the filter
+
+void fftfilt::init_output()
+{
+	output		= new cmplx[flen];
+	ovlbuf		= new cmplx[flen2];
+
+	memset(output, 0, flen * sizeof(cmplx));
+	memset(ovlbuf, 0, flen2 * sizeof(cmplx));
 }
 
 //------------------------------------------------------------------------------
@@ -86,6 +94,7 @@ fftfilt::fftfilt(double f1, double f2, int len)
 {
 	flen	= len;
 	init_filter();
+	init_output();
 	create_filter(f1, f2);
 }
 
@@ -96,9 +105,19 @@ fftfilt::fftfilt(double f, int len)
 {
 	flen	= len;
 	init_filter();
+	init_output();
 	create_lpf(f);
 }
 
+//------------------------------------------------------------------------------
+// filter without a response, the derived class creates it
+//------------------------------------------------------------------------------
+fftfilt::fftfilt(int len)
+{
+	flen	= len;
+	init_filter();
+}
+
 fftfilt::~fftfilt()
 {
 	if (fft) delete fft;
@@ -108,38 +127,33 @@ fftfilt::~fftfilt()
 	if (freqdata) delete [] freqdata;
 	if (output) delete [] output;
 	if (ovlbuf) delete [] ovlbuf;
-	if (ht) delete [] ht;
 }
 
 void fftfilt::create_filter(double f1, double f2)
 {
 // initialize the filter to zero
-	memset(ht, 0, flen * sizeof(cmplx));
+	memset(filter, 0, flen * sizeof(cmplx));
 
 // create the filter shape coefficients by fft
-// filter values initialized to the ht response h(t)
+// filter values initialized to the h(t) response
 	bool b_lowpass, b_highpass;//, window;
 	b_lowpass = (f2 != 0);
 	b_highpass = (f1 != 0);
 
 	for (int i = 0; i < flen2; i++) {
-		ht[i] = 0;
 //combine lowpass / highpass
 // lowpass @ f2
-		if (b_lowpass) ht[i] += fsinc(f2, i, flen2);
+		if (b_lowpass) filter[i] += fsinc(f2, i, flen2);
 // highighpass @ f1
-		if (b_highpass) ht[i] -= fsinc(f1, i, flen2);
+		if (b_highpass) filter[i] -= fsinc(f1, i, flen2);
 	}
 // highpass is delta[flen2/2] - h(t)
-	if (b_highpass && f2 < f1) ht[flen2 / 2] += 1;
+	if (b_highpass && f2 < f1) filter[flen2 / 2] += 1;
 
 	for (int i = 0; i < flen2; i++)
-		ht[i] *= _blackman(i, flen2);
+		filter[i] *= _blackman(i, flen2);
 
-// this may change since green fft is in place fft
-	memcpy(filter, ht, flen * sizeof(cmplx));
-
-// ht is flen complex points with imaginary all zero
+// h(t) is flen complex points with imaginary all zero
 // first half describes h(t), second half all zeros
 // perform the cmplx forward fft to obtain H(w)
 // filter is flen/2 complex values
@@ -169,10 +183,10 @@ void fftfilt::create_filter(double f1, double f2)
 
 	std::fstream fspec;
 	fspec.open("fspec.csv", std::ios::out);
-	fspec << "i,imp.re,imp.im,filt.re,filt.im,filt.abs,revimp.re,revimp.im\n";
+	fspec << "i,filt.re,filt.im,filt.abs,revimp.re,revimp.im\n";
 	for (int i = 0; i < flen2; i++)
 		fspec
-			<< i << "," << ht[i].real() << "," << ht[i].imag() << ","
+			<< i << ","
 			<< filter[i].real() << "," << filter[i].imag() << ","
 			<< abs(filter[i]) << ","
 			<< revht[i].real() << "," << revht[i].imag() << ","
@@ -183,10 +197,64 @@ void fftfilt::create_filter(double f1, double f2)
 	pass = 2;
 }
 
+//------------------------------------------------------------------------------
+// move the filter response up by the whole number of bins nearest to f
+//
+// Mixing the input down by f and then filtering is the same as filtering
+// with the response shifted up by f and mixing the output down.  Filters
+// that are shifted to different frequencies can then share the input.
+// The part of f below one bin is left to the caller's output mixer.
+//------------------------------------------------------------------------------
+void fftfilt::shift_filter(double f)
+{
+	fbin = filter_bin(f);
+}
+
+//------------------------------------------------------------------------------
+// move the filter response up by a whole number of bins
+//
+// The response of a filter moved by whole bins is the same impulse response
+// modulated by an exact number of cycles over the block, so it still fits
+// in the first half of the block and is not wrapped around.  The bins are
+// taken from the unshifted response, nothing is rebuilt when the bin changes.
+//------------------------------------------------------------------------------
+int fftfilt::filter_bin(double f)
+{
+	int bin = (int)floor(f * flen + 0.5) % flen;
+	if (bin < 0) bin += flen;
+	return bin;
+}
+
+void fftfilt::multiply_filter(const cmplx *in, cmplx *out, int bin)
+{
+	const cmplx *h = filter + flen - bin;
+	for (int i = 0; i < bin; i++)
+		out[i] = in[i] * h[i];
+	h = filter - bin;
+	for (int i = bin; i < flen; i++)
+		out[i] = in[i] * h[i];
+}
+
 /*
  * Filter with fast convolution (overlap-add algorithm).
  */
 
+// multiply the block spectrum in freqdata with the filter shape, transform
+// back to the time domain and overlap-add the flen/2 output samples to out
+
+void fftfilt::convolve(cmplx *out)
+{
+	multiply_filter(freqdata, freqdata, fbin);
+
+	fft->InverseComplexFFT(freqdata);
+
+// save the second half for overlapping next inverse FFT
+	for (int i = 0; i < flen2; i++) {
+		out[i] = ovlbuf[i] + freqdata[i];
+		ovlbuf[i] = freqdata[i+flen2];
+	}
+}
+
 int fftfilt::run(const cmplx & in, cmplx **out)
 {
 // collect flen/2 input samples
@@ -200,19 +268,8 @@ int fftfilt::run(const cmplx & in, cmplx **out)
 	memcpy(freqdata, timedata, flen * sizeof(cmplx));
 	fft->ComplexFFT(freqdata);
 
-// multiply with the filter shape
-	for (int i = 0; i < flen; i++)
-		freqdata[i] *= filter[i];
-
-// transform back to time domain
-	fft->InverseComplexFFT(freqdata);
-
-// overlap and add
-// save the second half for overlapping next inverse FFT
-	for (int i = 0; i < flen2; i++) {
-		output[i] = ovlbuf[i] + freqdata[i];
-		ovlbuf[i] = freqdata[i+flen2];
-	}
+// filter and overlap and add
+	convolve(output);
 
 // clear inbuf pointer
 	inptr = 0;
@@ -224,6 +281,79 @@ int fftfilt::run(const cmplx & in, cmplx **out)
 	return flen2;
 }
 
+// out must hold the flen/2 blocks completed by len samples,
+// len + flen/2 samples is always enough
+
+int fftfilt::run(const cmplx *in, int len, cmplx *out)
+{
+	int n_out = 0;
+
+	while (len > 0) {
+		int n = flen2 - inptr;
+		if (n > len) n = len;
+		memcpy(&timedata[inptr], in, n * sizeof(cmplx));
+		inptr += n;
+		in += n;
+		len -= n;
+
+		if (inptr < flen2)
+			break;
+		inptr = 0;
+		if (pass) --pass;
+
+		memcpy(freqdata, timedata, flen * sizeof(cmplx));
+		fft->ComplexFFT(freqdata);
+
+// outputs are discarded until the filter is stable
+		if (pass)
+			convolve(output);
+		else {
+			convolve(&out[n_out]);
+			n_out += flen2;
+		}
+	}
+	return n_out;
+}
+
+// other must have the same length as this filter and be reset with it,
+// only the input blocks collected by this filter are used
+
+int fftfilt::run_pair(fftfilt &other, const cmplx *in, int len,
+					  cmplx *out, cmplx *other_out)
+{
+	int n_out = 0;
+
+	while (len > 0) {
+		int n = flen2 - inptr;
+		if (n > len) n = len;
+		memcpy(&timedata[inptr], in, n * sizeof(cmplx));
+		inptr += n;
+		in += n;
+		len -= n;
+
+		if (inptr < flen2)
+			break;
+		inptr = 0;
+		if (pass) --pass;
+		if (other.pass) --other.pass;
+
+// one forward FFT for both filters
+		memcpy(freqdata, timedata, flen * sizeof(cmplx));
+		fft->ComplexFFT(freqdata);
+		memcpy(other.freqdata, freqdata, flen * sizeof(cmplx));
+
+		if (pass || other.pass) {
+			convolve(output);
+			other.convolve(other.output);
+		} else {
+			convolve(&out[n_out]);
+			other.convolve(&other_out[n_out]);
+			n_out += flen2;
+		}
+	}
+	return n_out;
+}
+
 //------------------------------------------------------------------------------
 // rtty filter
 //------------------------------------------------------------------------------
@@ -302,3 +432,106 @@ void fftfilt::rtty_filter(double f)
 	pass = 2;
 }
 
+
+//------------------------------------------------------------------------------
+// fft channelizer
+//
+// Mixing the input down by the tone frequency and then filtering is the
+// same as filtering with the response shifted up to the tone and mixing
+// the output down.  The shifted filter only needs the spectrum of the
+// input, so one forward FFT serves every tone in the bank.  The response
+// is shifted by a whole number of bins, the residual fraction of a bin
+// only moves the filter centre, the oscillator mixes the exact frequency.
+// Each tone keeps its own overlap and output buffers.
+//------------------------------------------------------------------------------
+
+fftchannelizer::fftchannelizer(double f, int len, int n, double sr)
+	: fftfilt(len)
+{
+	ntones = n;
+	samplerate = sr;
+
+	workdata = new cmplx[flen];
+	tones = new tone_t[ntones];
+
+	for (int i = 0; i < ntones; i++) {
+		tones[i].ovlbuf = new cmplx[flen2];
+		tones[i].output = new cmplx[flen2];
+		reset_tone(i);
+	}
+
+	create_lpf(f);
+}
+
+fftchannelizer::~fftchannelizer()
+{
+	for (int i = 0; i < ntones; i++) {
+		delete [] tones[i].ovlbuf;
+		delete [] tones[i].output;
+	}
+	delete [] tones;
+	delete [] workdata;
+}
+
+void fftchannelizer::rtty_filter(double f)
+{
+	fftfilt::rtty_filter(f);
+	for (int i = 0; i < ntones; i++)
+		reset_tone(i);
+}
+
+void fftchannelizer::reset_tone(int tone)
+{
+	tones[tone].active = false;
+}
+
+bool fftchannelizer::collect(const cmplx &in)
+{
+	timedata[inptr++] = in;
+
+	if (inptr < flen2)
+		return false;
+
+// one forward FFT of the input block for all of the tones
+	memcpy(freqdata, timedata, flen * sizeof(cmplx));
+	fft->ComplexFFT(freqdata);
+
+	inptr = 0;
+	return true;
+}
+
+cmplx *fftchannelizer::run_tone(int tone, double freq)
+{
+	tone_t &t = tones[tone];
+
+	if (!t.active || freq != t.freq) {
+		if (!t.active) {
+			memset(t.ovlbuf, 0, flen2 * sizeof(cmplx));
+			t.phasor = cmplx(1, 0);
+			t.pass = 2; // filter output is not stable until 2 passes
+			t.active = true;
+		}
+		t.freq = freq;
+		t.rot = cmplx(cos(2.0 * M_PI * freq / samplerate), -sin(2.0 * M_PI * freq / samplerate));
+		t.bin = filter_bin(freq / samplerate);
+	}
+	if (t.pass) --t.pass;
+
+// multiply the input spectrum with the filter shape moved up to the tone
+	multiply_filter(freqdata, workdata, t.bin);
+
+	fft->InverseComplexFFT(workdata);
+
+// overlap and add, then mix down to baseband
+	for (int i = 0; i < flen2; i++) {
+		t.output[i] = (t.ovlbuf[i] + workdata[i]) * t.phasor;
+		t.ovlbuf[i] = workdata[i + flen2];
+		t.phasor *= t.rot;
+	}
+// keep the oscillator amplitude from drifting
+	t.phasor /= abs(t.phasor);
+
+	if (t.pass) return 0;
+
+	return t.output;
+}
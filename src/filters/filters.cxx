@@ -31,6 +31,7 @@
 #include <string.h>
 
 #include "filters.h"
+#include "simd.h"
 
 #include <iostream>
 
@@ -186,6 +187,32 @@ int C_FIR_filter::run (const cmplx &in, cmplx &out) {
 	return 0;
 }
 
+//=====================================================================
+// Run a block
+// passes len cmplx values (in) and writes the decimated cmplx values
+// to (out), which must have room for len / decimation + 1 values
+// function returns the number of decimated values written
+//=====================================================================
+
+int C_FIR_filter::run (const cmplx *in, int len, cmplx *out) {
+	int n = 0;
+	for (int i = 0; i < len; i++) {
+		ibuffer[pointer] = in[i].real();
+		qbuffer[pointer] = in[i].imag();
+		if (++counter == decimateratio) {
+			out[n++] = cmplx (	mac(&ibuffer[pointer - length], ifilter, length),
+								mac(&qbuffer[pointer - length], qfilter, length) );
+			counter = 0;
+		}
+		if (++pointer == FIRBufferLen) {
+			memmove (ibuffer, ibuffer + FIRBufferLen - length, length * sizeof (double) );
+			memmove (qbuffer, qbuffer + FIRBufferLen - length, length * sizeof (double) );
+			pointer = length;
+		}
+	}
+	return n;
+}
+
 //=====================================================================
 // Run the filter for the Real part of the cmplx variable
 //=====================================================================
@@ -398,32 +425,116 @@ void Cmovavg::reset()
 //
 //=====================================================================
 
-struct sfft::vrot_bins_pair {
-	cmplx vrot;
-	cmplx bins;
-} ;
+// bins = bins * vrot + z * vrot, with the real and imaginary parts of the
+// bins and rotations in separate arrays so that adjacent bins fill the
+// vector lanes.  The products and sums are those of the complex form.
+static inline __attribute__((always_inline))
+void sfft_update_scalar(double *binre, double *binim, const double *rotre,
+		const double *rotim, int i, int n, double zre, double zim)
+{
+	for (; i < n; i++) {
+		double br = binre[i], bi = binim[i];
+		double vr = rotre[i], vi = rotim[i];
+		binre[i] = (br * vr - bi * vi) + (zre * vr - zim * vi);
+		binim[i] = (br * vi + bi * vr) + (zre * vi + zim * vr);
+	}
+}
+
+#ifndef SIMD_VECTORS
+static void sfft_update(double *binre, double *binim, const double *rotre,
+		const double *rotim, int n, double zre, double zim)
+{
+	sfft_update_scalar(binre, binim, rotre, rotim, 0, n, zre, zim);
+}
+#else
+template <typename V, int LANES>
+static inline __attribute__((always_inline))
+void sfft_update_vec(double *binre, double *binim, const double *rotre,
+		const double *rotim, int n, double zre, double zim)
+{
+	const V Zre = V() + zre;
+	const V Zim = V() + zim;
+	int i = 0;
+
+	for (; i + LANES <= n; i += LANES) {
+		V br, bi, vr, vi;
+		__builtin_memcpy(&br, binre + i, sizeof(V));
+		__builtin_memcpy(&bi, binim + i, sizeof(V));
+		__builtin_memcpy(&vr, rotre + i, sizeof(V));
+		__builtin_memcpy(&vi, rotim + i, sizeof(V));
+		V nr = (br * vr - bi * vi) + (Zre * vr - Zim * vi);
+		V ni = (br * vi + bi * vr) + (Zre * vi + Zim * vr);
+		__builtin_memcpy(binre + i, &nr, sizeof(V));
+		__builtin_memcpy(binim + i, &ni, sizeof(V));
+	}
+	sfft_update_scalar(binre, binim, rotre, rotim, i, n, zre, zim);
+}
+
+typedef double sfft_v2d __attribute__((vector_size(16)));
+typedef double sfft_v4d __attribute__((vector_size(32)));
+
+static void sfft_update_128(double *binre, double *binim, const double *rotre,
+		const double *rotim, int n, double zre, double zim)
+{
+	sfft_update_vec<sfft_v2d, 2>(binre, binim, rotre, rotim, n, zre, zim);
+}
+
+#ifdef SIMD_AVX2
+__attribute__((target("avx2")))
+static void sfft_update_256(double *binre, double *binim, const double *rotre,
+		const double *rotim, int n, double zre, double zim)
+{
+	sfft_update_vec<sfft_v4d, 4>(binre, binim, rotre, rotim, n, zre, zim);
+}
+#endif
+#endif // SIMD_VECTORS
+
+static sfft::update_fn sfft_select_update(void)
+{
+#ifdef SIMD_VECTORS
+#  ifdef SIMD_AVX2
+	if (simd_have_avx2())
+		return sfft_update_256;
+#  endif
+	return sfft_update_128;
+#else
+	return sfft_update;
+#endif
+}
 
 sfft::sfft(int len, int _first, int _last)
 {
-	vrot_bins = new vrot_bins_pair[len];
 	delay  = new cmplx[len];
 	fftlen = len;
 	first = _first;
 	last = _last;
 	ptr = 0;
+	int n = last - first;
+	rotre = new double[n];
+	rotim = new double[n];
+	binre = new double[n];
+	binim = new double[n];
 	double phi = 0.0, tau = 2.0 * M_PI/ len;
 	k2 = 1.0;
 	for (int i = 0; i < len; i++) {
-		vrot_bins[i].vrot = cmplx( K1 * cos (phi), K1 * sin (phi) );
+		if (i >= first && i < last) {
+			rotre[i - first] = K1 * cos (phi);
+			rotim[i - first] = K1 * sin (phi);
+			binre[i - first] = binim[i - first] = 0.0;
+		}
 		phi += tau;
-		delay[i] = vrot_bins[i].bins = 0.0;
+		delay[i] = 0.0;
 		k2 *= K1;
 	}
+	update = sfft_select_update();
 }
 
 sfft::~sfft()
 {
-	delete [] vrot_bins;
+	delete [] rotre;
+	delete [] rotim;
+	delete [] binre;
+	delete [] binim;
 	delete [] delay;
 }
 
@@ -440,14 +551,10 @@ void sfft::run(const cmplx& input, cmplx * __restrict__ result, int stride )
 	++ptr ;
 	if( ptr >= fftlen ) ptr = 0 ;
 
-	// It is more efficient to have vrot and bins very close to each other.
-	for(	vrot_bins_pair
-			* __restrict__ itr = vrot_bins + first,
-			* __restrict__ end = vrot_bins + last ;
-		itr != end ;
-		++itr, result += stride ) {
-		*result = itr->bins = itr->bins * itr->vrot + z * itr->vrot;
-	}
+	update(binre, binim, rotre, rotim, last - first, z.real(), z.imag());
+
+	for (int i = 0; i < last - first; i++, result += stride)
+		*result = cmplx(binre[i], binim[i]);
 }
 
 // ============================================================================
@@ -31,6 +31,97 @@
 
 #include "viterbi.h"
 #include "misc.h"
+#include "simd.h"
+
+/* ---------------------------------------------------------------------- */
+// Vector add-compare-select
+//
+// When both polynomials use the oldest and the newest bit, old states j and
+// j + nstates/2 lead to new states 2j and 2j+1, and the four branches carry
+// the metrics +t, -t, -t, +t with t the branch metric of state 2j.  The
+// butterflies of adjacent j are done side by side, with the same compares
+// and tie breaking as the scalar loop in viterbi::decode.
+/* ---------------------------------------------------------------------- */
+
+#ifdef SIMD_VECTORS
+template <typename V, int LANES>
+static inline __attribute__((always_inline))
+void viterbi_acs(const int *prev, int *curr, int *hist,
+		const int *sign0, const int *sign1, int a, int b, int nstates)
+{
+	const int half = nstates / 2;
+	const V va = V() + a;
+	const V vb = V() + b;
+	const V vhalf = V() + half;
+	V lane, lo, hi;
+	for (int i = 0; i < LANES; i++) {
+		lane[i] = i;
+		lo[i] = (i & 1) * LANES + i / 2;
+		hi[i] = (i & 1) * LANES + (i + LANES) / 2;
+	}
+
+	for (int j = 0; j < half; j += LANES) {
+		V m0, m1, s0, s1;
+		__builtin_memcpy(&m0, prev + j, sizeof(V));
+		__builtin_memcpy(&m1, prev + j + half, sizeof(V));
+		__builtin_memcpy(&s0, sign0 + j, sizeof(V));
+		__builtin_memcpy(&s1, sign1 + j, sizeof(V));
+
+		V t = ((va ^ s0) - s0) + ((vb ^ s1) - s1);
+		V e0 = m0 + t, e1 = m1 - t;	// to state 2j
+		V o0 = m0 - t, o1 = m1 + t;	// to state 2j+1
+		V de = e0 > e1;
+		V dodd = o0 > o1;
+		V me = (e0 & de) | (e1 & ~de);
+		V mo = (o0 & dodd) | (o1 & ~dodd);
+		V he = lane + j + (vhalf & ~de);
+		V ho = lane + j + (vhalf & ~dodd);
+
+		V r = __builtin_shuffle(me, mo, lo);
+		__builtin_memcpy(curr + 2 * j, &r, sizeof(V));
+		r = __builtin_shuffle(me, mo, hi);
+		__builtin_memcpy(curr + 2 * j + LANES, &r, sizeof(V));
+		r = __builtin_shuffle(he, ho, lo);
+		__builtin_memcpy(hist + 2 * j, &r, sizeof(V));
+		r = __builtin_shuffle(he, ho, hi);
+		__builtin_memcpy(hist + 2 * j + LANES, &r, sizeof(V));
+	}
+}
+
+typedef int viterbi_v4si __attribute__((vector_size(16)));
+typedef int viterbi_v8si __attribute__((vector_size(32)));
+
+static void viterbi_acs_128(const int *prev, int *curr, int *hist,
+		const int *sign0, const int *sign1, int a, int b, int nstates)
+{
+	viterbi_acs<viterbi_v4si, 4>(prev, curr, hist, sign0, sign1, a, b, nstates);
+}
+
+#ifdef SIMD_AVX2
+__attribute__((target("avx2")))
+static void viterbi_acs_256(const int *prev, int *curr, int *hist,
+		const int *sign0, const int *sign1, int a, int b, int nstates)
+{
+	viterbi_acs<viterbi_v8si, 8>(prev, curr, hist, sign0, sign1, a, b, nstates);
+}
+#endif
+
+static viterbi::acs_fn viterbi_select_acs(int nstates)
+{
+#ifdef SIMD_AVX2
+	if (simd_have_avx2() && nstates / 2 >= 8)
+		return viterbi_acs_256;
+#endif
+	if (nstates / 2 >= 4)
+		return viterbi_acs_128;
+	return 0;
+}
+#else
+static viterbi::acs_fn viterbi_select_acs(int nstates)
+{
+	return 0;
+}
+#endif
 
 /* ---------------------------------------------------------------------- */
 viterbi::viterbi(int k, int poly1, int poly2)
@@ -57,6 +148,22 @@ viterbi::viterbi(int k, int poly1, int poly2)
 		mettab[0][i] = 128 - i;
 		mettab[1][i] = i - 128;
 	}
+
+	acs = viterbi_select_acs(nstates);
+	for (int i = 0; acs && i < nstates; i++) {
+		if (output[i + nstates] != (output[i] ^ 3) ||
+		    output[i ^ 1] != (output[i] ^ 3))
+			acs = 0;
+	}
+	bmsign[0] = bmsign[1] = 0;
+	if (acs) {
+		bmsign[0] = new int[nstates / 2];
+		bmsign[1] = new int[nstates / 2];
+		for (int j = 0; j < nstates / 2; j++) {
+			bmsign[0][j] = (output[2 * j] & 1) ? -1 : 0;
+			bmsign[1][j] = (output[2 * j] & 2) ? -1 : 0;
+		}
+	}
 	reset();
 }
 
@@ -67,6 +174,8 @@ viterbi::~viterbi()
 		if (metrics[i]) delete [] metrics[i];
 		if (history[i]) delete [] history[i];
 	}
+	delete [] bmsign[0];
+	delete [] bmsign[1];
 }
 
 void viterbi::reset()
@@ -76,12 +185,15 @@ void viterbi::reset()
 		memset(history[i], 0, nstates * sizeof(int));
 	}
 	ptr = 0;
+	count = 0;
+	tb_valid = false;
 }
 
 int viterbi::settraceback(int trace) {
 	if (trace < 0 || trace > PATHMEM - 1)
 	return -1;
 	_traceback = trace;
+	tb_valid = false;
 	return 0;
 }
 
@@ -110,15 +222,28 @@ int viterbi::traceback(int *metric)
 		}
 	}
 
-// Trace back 'traceback' steps, starting from the best state
+// Trace back 'traceback' steps, starting from the best state.  Once the
+// path meets the path of the last traceback it stays on it, and the rest
+// of sequence[] is already in place.
+	unsigned int newest = count - 1;
+	unsigned int oldest = newest - _traceback;
 	sequence[p] = beststate;
 
 	for (int i = 0; i < _traceback; i++) {
 		unsigned int prev = (p - 1) % PATHMEM;
+		unsigned int t = newest - i - 1;
+		int state = history[p][sequence[p]];
 
-		sequence[prev] = history[p][sequence[p]];
+		if (tb_valid && tb_newest - t <= (unsigned int)_traceback &&
+		    sequence[prev] == state) {
+			p = oldest % PATHMEM;
+			break;
+		}
+		sequence[prev] = state;
 		p = prev;
 	}
+	tb_newest = newest;
+	tb_valid = true;
 
 	if (metric)
 		*metric = metrics[p][sequence[p]];
@@ -155,6 +280,10 @@ int viterbi::decode(unsigned char *sym, int *metric)
 //	met[2] = sym[1] - sym[0];
 //	met[3] = sym[0] + sym[1] - 256;
 
+	if (acs) {
+		acs(metrics[prevptr], metrics[currptr], history[currptr],
+		    bmsign[0], bmsign[1], mettab[0][sym[0]], mettab[0][sym[1]], nstates);
+	} else
 	for (int n = 0; n < nstates; n++) {
 		int p0, p1, s0, s1, m0, m1;
 
@@ -179,6 +308,7 @@ int viterbi::decode(unsigned char *sym, int *metric)
 	}
 
 	ptr = (ptr + 1) % PATHMEM;
+	count++;
 
 	if ((ptr % _chunksize) == 0)
 		return traceback(metric);
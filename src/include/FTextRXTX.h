@@ -24,6 +24,7 @@
 #define FTextRXTX_H_
 
 #include <string>
+#include <cstring>
 
 #include "FTextView.h"
 
@@ -40,19 +41,14 @@ public:
 
 #if FLDIGI_FLTK_API_MAJOR == 1 && FLDIGI_FLTK_API_MINOR == 3
 	virtual void	add(unsigned int  c, int attr = RECV);
-	virtual	void	add(const char *s, int attr = RECV)
-        {
-                while (*s)
-                        add(*s++, attr);
-        }
 #else
 	virtual void	add(unsigned char c, int attr = RECV);
+#endif
 	virtual	void	add(const char *s, int attr = RECV)
         {
-                while (*s)
-                        add(*s++, attr);
+                add(s, strlen(s), attr);
         }
-#endif
+	void		add(const char *text, size_t len, int attr);
 
 	void		set_quick_entry(bool b);
 	bool		get_quick_entry(void) { return menu[RX_MENU_QUICK_ENTRY].value(); }
@@ -81,6 +77,12 @@ protected:
 	const char*	dxcc_lookup_call(int x, int y);
 	static void	dxcc_tooltip(void* obj);
 
+	void		insert_run(std::string& text, std::string& style);
+	int		line_width(void);
+	void		line_changed(void) { lw_len = 0; lw_width = 0.0; }
+	static void	count_lines_cb(int pos, int nins, int ndel, int nsty,
+				       const char *dtext, void *arg);
+
 private:
 	FTextRX();
 	FTextRX(const FTextRX &t);
@@ -91,6 +93,13 @@ protected:
 		bool enabled;
 		float delay;
 	} tooltips;
+
+	int		nlines;		///< newlines in the text buffer
+	// width of the first lw_len bytes of the current line
+	size_t		lw_len;
+	double		lw_width;
+	Fl_Font		lw_font;
+	int		lw_size;
 };
 
 
@@ -0,0 +1,242 @@
+// ----------------------------------------------------------------------------
+//	bcastbuffer.h
+//
+// Ringbuffer with one writer and any number of readers.  Each reader has
+// its own read position, the writer never waits for the readers and
+// overwrites the oldest data when the buffer is full.  A reader that has
+// fallen behind the writer by more than the buffer length loses samples,
+// and resumes according to its overrun policy:
+//
+//   OLDEST  resume near the oldest data still held, lose as little as possible
+//   NEWEST  resume at the newest data, skip everything that is queued
+//
+// The copying read method detects data that was overwritten while it was
+// being copied.  Vectors returned by get_rv point into the buffer, the
+// overrun method tells if they were overwritten while in use.
+//
+// Lock free for one writer thread, each reader may be used by one thread.
+// The indices are free running, buffer positions are taken modulo the
+// (power of 2) buffer size.
+//
+// This file is part of fldigi.
+//
+// Fldigi is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Fldigi is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with fldigi.  If not, see <http://www.gnu.org/licenses/>.
+// ----------------------------------------------------------------------------
+
+#ifndef BCASTBUFFER_H
+#define BCASTBUFFER_H
+
+#include <cassert>
+#include <cstring>
+#include "util.h"
+
+template <typename T>
+class bcastbuffer
+{
+protected:
+        size_t size, mask;
+        T* buf;
+// data up to widx has been written, the writer may be overwriting
+// up to resv, data before didx has been discarded
+        volatile size_t widx, resv, didx;
+
+public:
+        typedef T value_type;
+        typedef struct { value_type* buf; size_t len; } vector_type;
+        enum overrun_t { OLDEST, NEWEST };
+
+        class reader
+        {
+        protected:
+                bcastbuffer& rb;
+                overrun_t policy;
+                size_t ridx;
+                size_t vidx; // start of the vectors from get_rv
+                size_t nlost;
+
+// move the read position past discarded or overwritten data
+                void check(void)
+                {
+                        size_t w = rb.widx;
+                        read_memory_barrier();
+                        size_t d = rb.didx;
+                        size_t r = rb.resv;
+
+                        if (w - ridx > w - d) // discarded
+                                ridx = d;
+                        if (r - ridx > rb.size) { // overrun
+                                size_t to = (policy == NEWEST) ? w : r - rb.size + rb.size / 8;
+                                if (w - to > w - ridx) // never move backwards
+                                        to = w;
+                                nlost += to - ridx;
+                                ridx = to;
+                        }
+                }
+
+        public:
+                reader(bcastbuffer& b, overrun_t p = OLDEST)
+                        : rb(b), policy(p), nlost(0)
+                {
+                        ridx = vidx = rb.widx;
+                }
+
+                size_t read_space(void)
+                {
+                        check();
+                        return rb.widx - ridx;
+                }
+                void read_advance(size_t n)
+                {
+                        ridx += n;
+                }
+
+                size_t get_rv(vector_type v[2], size_t n = 0)
+                {
+                        size_t rspace = read_space();
+                        size_t index = ridx & rb.mask;
+
+                        if (n == 0 || n > rspace)
+                                n = rspace;
+                        vidx = ridx;
+
+                        if (index + n > rb.size) { // two part vector
+                                v[0].buf = rb.buf + index;
+                                v[0].len = rb.size - index;
+                                v[1].buf = rb.buf;
+                                v[1].len = n - v[0].len;
+                        }
+                        else {
+                                v[0].buf = rb.buf + index;
+                                v[0].len = n;
+                                v[1].len = 0;
+                        }
+
+                        return n;
+                }
+// true if the data returned by the last get_rv has been overwritten since
+                bool overrun(void)
+                {
+                        read_memory_barrier();
+                        return rb.resv - vidx > rb.size;
+                }
+
+                size_t read(T* dst, size_t n)
+                {
+                        vector_type v[2];
+                        size_t len;
+
+                        do {
+                                len = get_rv(v, n);
+                                memcpy(dst, v[0].buf, v[0].len * sizeof(T));
+                                if (v[1].len)
+                                        memcpy(dst + v[0].len, v[1].buf, v[1].len * sizeof(T));
+                        } while (overrun());
+
+                        read_advance(len);
+                        return len;
+                }
+
+// move to the oldest data still held, or to the newest
+                void rewind(void)
+                {
+                        ridx = rb.resv - rb.size;
+                        check();
+                }
+                void sync(void)
+                {
+                        ridx = rb.widx;
+                }
+
+// samples lost to overruns
+                size_t lost(void) { return nlost; }
+        };
+
+public:
+        bcastbuffer(size_t s)
+                : widx(0), resv(0), didx(0)
+        {
+                assert(powerof2(s));
+
+                size = s;
+                mask = size - 1;
+                buf = new T[size];
+                memset(buf, 0, size * sizeof(T));
+        }
+        ~bcastbuffer()
+        {
+                delete [] buf;
+        }
+
+// the writer always has n <= size samples of space, the oldest data
+// is given up when the vectors are taken
+        size_t get_wv(vector_type v[2], size_t n)
+        {
+                size_t index = widx & mask;
+
+                if (n > size)
+                        n = size;
+                resv = widx + n;
+                write_memory_barrier();
+
+                if (index + n > size) { // two part vector
+                        v[0].buf = buf + index;
+                        v[0].len = size - index;
+                        v[1].buf = buf;
+                        v[1].len = n - v[0].len;
+                }
+                else {
+                        v[0].buf = buf + index;
+                        v[0].len = n;
+                        v[1].len = 0;
+                }
+
+                return n;
+        }
+        void write_advance(size_t n)
+        {
+                write_memory_barrier();
+                widx += n;
+        }
+        size_t write(const T* src, size_t n)
+        {
+                vector_type v[2];
+                n = get_wv(v, n);
+
+                memcpy(v[0].buf, src, v[0].len * sizeof(T));
+                if (v[1].len)
+                        memcpy(v[1].buf, src + v[0].len, v[1].len * sizeof(T));
+
+                write_advance(n);
+                return n;
+        }
+
+// the readers skip everything written so far
+        void discard(void)
+        {
+                write_memory_barrier();
+                didx = widx;
+        }
+// samples written since the last discard
+        size_t write_count(void) { return widx - didx; }
+
+        size_t length(void) { return size; }
+        size_t bytes(void) { return size * sizeof(T); }
+};
+
+#endif // BCASTBUFFER_H
+
+// Local Variables:
+// mode: c++
+// c-file-style: "linux"
+// End:
@@ -2,6 +2,8 @@
 #define BENCHMARK_H_
 
 #include <string>
+#include <vector>
+#include <cstdio>
 #include <sys/types.h>
 #include "globals.h"
 
@@ -14,10 +16,27 @@ struct benchmark_params {
 	int src_type;
 	std::string input, output, buffer;
 	size_t samples;
+
+// runs over several modems, inputs and signal to noise ratios
+	bool all_modes;
+	std::vector<std::string> inputs;
+	std::vector<double> snr;
+	size_t blocksize;
+	std::string json;
+
+// micro benchmarks of decoder components, as NAME or NAME:INPUT
+	std::vector<std::string> kernels;
 };
 extern struct benchmark_params benchmark;
 
 int setup_benchmark(void);
-void do_benchmark(void);
+bool do_benchmark(void);
+
+// in benchmark_kernels.cxx
+bool run_kernel_benchmarks(FILE* json);
+
+void json_string(FILE* f, const std::string& s);
+bool read_reference(const std::string& input, std::string& text);
+size_t edit_distance(const std::string& a, const std::string& b);
 
 #endif
@@ -50,8 +50,13 @@
 
 #define SCOPESIZE 64
 
+#define MAXBINS (MAXFFTS * NUMTONES * 6)
+
+// pipe entries 1 .. CWITESTS are checked for CWI by harddecode
+#define CWITESTS 10
+
 struct domrxpipe {
-	cmplx vector[MAXFFTS * NUMTONES * 6];
+	cmplx vector[MAXBINS];
 };
 
 class dominoex : public modem {
@@ -89,6 +94,13 @@ protected:
 	
 	domrxpipe		*pipe;
 	unsigned int	pipeptr;
+	unsigned int	pipepass;
+// bin magnitudes of the current symbol, and of the pipe entries used by
+// the CWI test with the pass of the pipe they were taken in
+	double			binmag[MAXBINS];
+	double			cwimag[CWITESTS][MAXBINS];
+	unsigned int	cwipass[CWITESTS];
+	bool			cwivalid[CWITESTS];
 	mbuffer<double, 0, 2>	scopedata;
 	mbuffer<double, 0, 2>	videodata;
 
@@ -136,6 +148,8 @@ private:
 	void	recvchar(int c);
 	void	decodesymbol();
 	void	decodeDomino(int c);
+	void	binmags();
+	const double *cwimags(int j);
 	int		harddecode();
 	void	update_syncscope();
 	void	synchronize();
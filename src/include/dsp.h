@@ -33,6 +33,41 @@ template <class type> struct Cdspcmpx { type re,im; } ;
 
 typedef Cdspcmpx<double> dspCmpx;
 
+// The receiver filter and FFT kernels work on a dspCmpx as one vector
+// of two doubles, with the same arithmetic as the scalar code, so both
+// give identical results.  Only targets with vectors of doubles (SSE2,
+// aarch64 NEON) use them; elsewhere, 32 bit ARM NEON included, GCC would
+// split the vectors into scalar operations and the plain loops are kept.
+// Define MT63_NO_SIMD to use the scalar code.
+#if defined(__GNUC__) && !defined(MT63_NO_SIMD) && \
+	(defined(__SSE2__) || defined(__aarch64__))
+#  define MT63_HAVE_SIMD 1
+typedef double dspVec2 __attribute__((vector_size(16)));
+#endif
+
+// The same kernels in vectors of four floats, for targets that have them
+// (SSE, ARM NEON).  They convert their input to float and their output back
+// to double, so the decoder output differs slightly from the double path.
+// MT63_FLOAT_SIMD selects them at build time, see --enable-mt63-float:
+// 1 to use them, 0 for the double kernels.  By default they are used on
+// 32 bit ARM only, which has no vectors of doubles.  dspFloatKernels holds
+// the choice, and may be changed at any time to compare both paths in one
+// program.
+#if defined(__GNUC__) && !defined(MT63_NO_SIMD) && \
+	(defined(__SSE__) || defined(__ARM_NEON__) || defined(__ARM_NEON) || \
+	 defined(__aarch64__))
+#  define MT63_HAVE_FLOAT_SIMD 1
+typedef float dspVec4f __attribute__((vector_size(16)));
+#  ifndef MT63_FLOAT_SIMD
+#    if (defined(__ARM_NEON__) || defined(__ARM_NEON)) && !defined(__aarch64__)
+#      define MT63_FLOAT_SIMD 1
+#    else
+#      define MT63_FLOAT_SIMD 0
+#    endif
+#  endif
+extern bool dspFloatKernels;
+#endif
+
 // Some complex operators
 template <class type>
  inline void operator +=(Cdspcmpx<type> &Dst, Cdspcmpx<type> &Src)
@@ -771,6 +806,13 @@ class dspQuadrSplit
    int Len;
    double_buff Tap;
    double *ShapeI, *ShapeQ; int ExternShape;
+   double *ShapeIQ; // ShapeI and ShapeQ interleaved for the vector loop
+   int InterleaveShape(void);
+#ifdef MT63_HAVE_FLOAT_SIMD
+   float *ShapeIQF;   // ShapeIQ as float, padded to an even number of taps
+   float_buff TapF;   // the input as float, every sample twice
+   int ProcessFloat(int *InpUsed, int *OutLen);
+#endif
    int Rate;
 } ;
 
@@ -1052,6 +1094,13 @@ class dsp_r2FFT // radix-2 FFT
    int Size;	        // FFT size
    int *BitRevIdx;	// Bit-reverse indexing table for data (un)scrambling
    dspCmpx *Twiddle;	// Twiddle factors (sine/cos values)
+   double *TwiddleVec;	// Twiddle factors laid out for the vector butterflies
+#ifdef MT63_HAVE_FLOAT_SIMD
+   float *TwiddleVecF;	// float twiddles of each pass, two butterflies per vector
+   float *DataF;		// the data as float during CoreProc
+  private:
+   void CoreProcFloat(dspCmpx x[]);
+#endif
   private:
 //   double *Window;	// window shape (NULL => rectangular window
 //   double WinInpScale, WinOutScale; // window scales on input/output
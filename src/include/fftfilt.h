@@ -18,7 +18,6 @@ protected:
 	int flen2;
 	g_fft<double> *fft;
 	g_fft<double> *ift;
-	cmplx *ht;
 	cmplx *filter;
 	cmplx *timedata;
 	cmplx *freqdata;
@@ -27,6 +26,7 @@ protected:
 	int inptr;
 	int pass;
 	int window;
+	int fbin;
 
 	inline double fsinc(double fc, int i, int len) {
 		return (i == len/2) ? 2.0 * fc: 
@@ -38,6 +38,15 @@ protected:
 				 0.08 * cos(4.0 * M_PI * i / len));
 	}
 	void init_filter();
+	void init_output();
+	void convolve(cmplx *out);
+// the bin nearest to f (fraction of the sample rate)
+	int filter_bin(double f);
+// out = in * filter response moved up by bin bins
+	void multiply_filter(const cmplx *in, cmplx *out, int bin);
+
+// for derived classes with their own overlap and output buffers
+	fftfilt(int len);
 
 public:
 	fftfilt(double f1, double f2, int len);
@@ -53,8 +62,56 @@ public:
 		create_filter(f, 0);
 	}
 	void rtty_filter(double);
+// move the filter response up by the whole bins nearest to f (fraction of the
+// sample rate)
+	void shift_filter(double f);
 
 	int run(const cmplx& in, cmplx **out);
+// filter len samples, the completed flen/2 output blocks are written to out
+// returns the number of output samples
+	int run(const cmplx *in, int len, cmplx *out);
+// filter the same input with this and another filter of the same length,
+// sharing the forward FFT of each block
+	int run_pair(fftfilt &other, const cmplx *in, int len, cmplx *out, cmplx *other_out);
+	int run_length() { return flen2; }
+};
+
+//----------------------------------------------------------------------
+// Bank of fftfilt tone channels sharing a single forward FFT of the input.
+// Each tone is filtered by moving the filter response up to the bin of the
+// tone in the frequency domain, and the filter output is then mixed down to
+// baseband with a recursive oscillator.
+
+class fftchannelizer : public fftfilt {
+protected:
+	struct tone_t {
+		double	freq;
+		int		bin;
+		int		pass;
+		bool	active;
+		cmplx	phasor;
+		cmplx	rot;
+		cmplx	*ovlbuf;
+		cmplx	*output;
+	};
+
+	int ntones;
+	tone_t *tones;
+	double samplerate;
+	cmplx *workdata;
+
+public:
+	fftchannelizer(double f, int len, int ntones, double samplerate);
+	~fftchannelizer();
+
+	void rtty_filter(double);
+
+// collect an input sample, true when a new block is ready for run_tone
+	bool collect(const cmplx& in);
+// filter the current block at freq, returns flen/2 baseband samples
+// or NULL while the tone filter is not yet stable
+	cmplx *run_tone(int tone, double freq);
+	void reset_tone(int tone);
 };
 
 #endif
@@ -99,8 +99,11 @@ public:
 	double *bp_FIR(int len, int hilbert, double f1, double f2);
 	void dump();
 	int run (const cmplx &in, cmplx &out);
+	int run (const cmplx *in, int len, cmplx *out);
 	int Irun (const double &in, double &out);
 	int Qrun (const double &in, double &out);
+// number of input samples until the next decimated output
+	int samples_to_output() { return decimateratio - counter; }
 };
 
 //=====================================================================
@@ -125,19 +128,25 @@ public:
 
 //=====================================================================
 // Sliding FFT
+//
+// Bins first .. last - 1 are updated for every input sample.
 //=====================================================================
 
 class sfft {
 #define K1 0.99999999999L
+public:
+	typedef void (*update_fn)(double *binre, double *binim, const double *rotre,
+			const double *rotim, int n, double zre, double zim);
 private:
 	int fftlen;
 	int first;
 	int last;
 	int ptr;
-	struct vrot_bins_pair ;
-	vrot_bins_pair * __restrict__ vrot_bins ;
+	double *rotre, *rotim;
+	double *binre, *binim;
 	cmplx * __restrict__ delay;
 	double k2;
+	update_fn update;
 public:
 	sfft(int len, int first, int last);
 	~sfft();
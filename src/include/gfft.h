@@ -49,6 +49,8 @@
 
 #include <complex>
 
+#include "gfft_simd.h"
+
 template <typename FFT_TYPE>
 class g_fft {
 #define FFT_RECIPLN2  1.442695040888963407359924681001892137426 // 1.0/log(2) 
@@ -74,6 +76,12 @@ private:
 	FFT_TYPE	*Utbl;
 	short		*BRLow;
 
+// vector radix 8 stages, see gfft_simd.h
+// twiddle layouts are built on first use, per direction and log2(NDiffU)
+	typename gfft_simd<FFT_TYPE>::radix8_fn simd_radix8;
+	int			simd_lanes;
+	FFT_TYPE	*simd_tw[2][32];
+
 	void fftInit();
 	int ConvertFFTSize(int);
 
@@ -116,6 +124,9 @@ private:
 	void bitrevR2(FFT_TYPE *ioptr, int M, short *BRLow);
 	void fftBRInit(int M, short *BRLow);
 	void fftCosInit(int M, FFT_TYPE *Utbl);
+	FFT_TYPE *simd_twiddles(int M, FFT_TYPE *Utbl, int Ustride, int NDiffU, bool inverse);
+	void simd_stages(FFT_TYPE *ioptr, int M, FFT_TYPE *Utbl, int Ustride,
+				int NDiffU, int StageCnt, bool inverse);
 	
 public:
 	g_fft(int M = 8192) {
@@ -128,6 +139,8 @@ public:
 		for (int i = 0; i < 32; i++) {
 			if (FFT_table_1[i] != 0) delete [] FFT_table_1[i];
 			if (FFT_table_2[i] != 0) delete [] FFT_table_2[i];
+			if (simd_tw[0][i] != 0) delete [] simd_tw[0][i];
+			if (simd_tw[1][i] != 0) delete [] simd_tw[1][i];
 		}
 	}
 
@@ -137,6 +150,12 @@ public:
 	void InverseRealFFT(std::complex<FFT_TYPE> *buf);
 	FFT_TYPE GetInverseComplexFFTScale();
 	FFT_TYPE GetInverseRealFFTScale();
+
+// limit the vector stages to width bits, 0 for the scalar stages only;
+// used to compare the kernels on one cpu
+	void set_simd_width(int width) {
+		simd_radix8 = gfft_simd<FFT_TYPE>::select(simd_lanes, width);
+	}
 };
 
 //------------------------------------------------------------------------------
@@ -853,6 +872,19 @@ template <typename FFT_TYPE>
 void g_fft<FFT_TYPE>::bfstages(FFT_TYPE *ioptr, int M, FFT_TYPE *Utbl, int Ustride,
 					 int NDiffU, int StageCnt)
 {
+	if (simd_radix8) {
+		if (NDiffU >= simd_lanes) {
+			simd_stages(ioptr, M, Utbl, Ustride, NDiffU, StageCnt, false);
+			return;
+		}
+// too few butterflies for the vector lanes in the first stage
+		if (StageCnt > 1) {
+			bfstages(ioptr, M, Utbl, Ustride, NDiffU, 1);
+			bfstages(ioptr, M, Utbl, Ustride, NDiffU * 8, StageCnt - 1);
+			return;
+		}
+	}
+
 	unsigned int pos;
 	unsigned int posi;
 	unsigned int pinc;
@@ -1899,6 +1931,19 @@ template <typename FFT_TYPE>
 void g_fft<FFT_TYPE>::ibfstages(FFT_TYPE *ioptr, int M, FFT_TYPE *Utbl, int Ustride,
 					  int NDiffU, int StageCnt)
 {
+	if (simd_radix8) {
+		if (NDiffU >= simd_lanes) {
+			simd_stages(ioptr, M, Utbl, Ustride, NDiffU, StageCnt, true);
+			return;
+		}
+// too few butterflies for the vector lanes in the first stage
+		if (StageCnt > 1) {
+			ibfstages(ioptr, M, Utbl, Ustride, NDiffU, 1);
+			ibfstages(ioptr, M, Utbl, Ustride, NDiffU * 8, StageCnt - 1);
+			return;
+		}
+	}
+
 	unsigned int pos;
 	unsigned int posi;
 	unsigned int pinc;
@@ -3262,6 +3307,100 @@ void g_fft<FFT_TYPE>::fftInit()
 	Utbl = ((FFT_TYPE**) FFT_table_1)[FFT_N];
 	BRLow = ((short**) FFT_table_2)[FFT_N / 2];
 
+	simd_radix8 = gfft_simd<FFT_TYPE>::select(simd_lanes);
+	for (int i = 0; i < 32; i++)
+		simd_tw[0][i] = simd_tw[1][i] = (FFT_TYPE*)0;
+}
+
+//------------------------------------------------------------------------------
+// Lay out the twiddles of one radix 8 stage for the vector kernels.
+// The table walk is the one done by bfstages / ibfstages, the twiddles are
+// stored per butterfly as w and j*w for the forward transform, and as
+// conj(w) and -j*conj(w) for the inverse, so the kernels only multiply.
+// The twiddle angles only depend on NDiffU, so each layout is built once.
+//------------------------------------------------------------------------------
+template <typename FFT_TYPE>
+FFT_TYPE *g_fft<FFT_TYPE>::simd_twiddles(int M, FFT_TYPE *Utbl, int Ustride, int NDiffU,
+						bool inverse)
+{
+	int L = 0;
+	while (POW2(L) < (unsigned int) NDiffU) L++;
+	if (simd_tw[inverse][L])
+		return simd_tw[inverse][L];
+
+	const unsigned int twlen = 2 * NDiffU;
+	FFT_TYPE *tw = simd_tw[inverse][L] = new FFT_TYPE[GFFT_SIMD_TWIDDLES * 2 * twlen];
+	const FFT_TYPE sign = inverse ? FFT_TYPE(1.0) : FFT_TYPE(-1.0);
+	unsigned int NSameU = POW2(M) / 8 / NDiffU;
+	int Uinc = (int) NSameU * Ustride;
+	int Uinc2 = Uinc * 2;
+	int Uinc4 = Uinc * 4;
+	unsigned int U2toU3 = (POW2(M) / 8) * Ustride;
+	FFT_TYPE *u0r, *u0i, *u1r, *u1i, *u2r, *u2i;
+	FFT_TYPE w[4][2];
+
+	u0r = &Utbl[0];
+	u0i = &Utbl[POW2(M - 2) * Ustride];
+	u1r = u0r;
+	u1i = u0i;
+	u2r = u0r;
+	u2i = u0i;
+
+	for (int DiffUCnt = NDiffU, d = 0; DiffUCnt > 0; DiffUCnt--, d += 2) {
+		w[0][0] = *u0r;
+		w[0][1] = *u0i;
+		if (DiffUCnt < NDiffU && DiffUCnt + 1 <= NDiffU / 2)
+			w[0][0] = -w[0][0];
+		w[1][0] = *u1r;
+		w[1][1] = *u1i;
+		w[2][0] = *u2r;
+		w[2][1] = *u2i;
+		w[3][0] = *(u2r + U2toU3);
+		w[3][1] = *(u2i - U2toU3);
+
+// twiddle kinds: w0, w1, jw1, w2, jw2, w3, jw3
+		for (int k = 0; k < GFFT_SIMD_TWIDDLES; k++) {
+			FFT_TYPE *twr = tw + 2 * k * twlen + d;
+			FFT_TYPE *twi = twr + twlen;
+			int n = (k + 1) / 2;
+			FFT_TYPE re = w[n][0];
+			FFT_TYPE im = sign * w[n][1];
+			if (k && !(k & 1)) {
+// multiply by j (forward) or -j (inverse)
+				FFT_TYPE t = re;
+				re = sign * im;
+				im = -sign * t;
+			}
+			twr[0] = twr[1] = re;
+			twi[0] = -im;
+			twi[1] = im;
+		}
+
+		if (DiffUCnt == NDiffU / 2)
+			Uinc4 = -Uinc4;
+
+		u0r += Uinc4;
+		u0i -= Uinc4;
+		u1r += Uinc2;
+		u1i -= Uinc2;
+		u2r += Uinc;
+		u2i -= Uinc;
+	}
+	return tw;
+}
+
+//------------------------------------------------------------------------------
+// radix 8 stages with the vector kernels
+//------------------------------------------------------------------------------
+template <typename FFT_TYPE>
+void g_fft<FFT_TYPE>::simd_stages(FFT_TYPE *ioptr, int M, FFT_TYPE *Utbl, int Ustride,
+					int NDiffU, int StageCnt, bool inverse)
+{
+	for (; StageCnt > 0; StageCnt--) {
+		simd_radix8(ioptr, NDiffU, POW2(M) / 8 / NDiffU, NDiffU * 2,
+				simd_twiddles(M, Utbl, Ustride, NDiffU, inverse));
+		NDiffU *= 8;
+	}
 }
 
 //------------------------------------------------------------------------------
@@ -0,0 +1,237 @@
+//==============================================================================
+// gfft_simd.h:
+//
+// Vector radix 8 butterfly stages for g_fft
+//
+// This file is part of fldigi.
+//
+// Fldigi is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Fldigi is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with fldigi.  If not, see <http://www.gnu.org/licenses/>.
+//==============================================================================
+//==============================================================================
+// The radix 8 stages do nearly all of the work of a g_fft transform.  These
+// kernels compute the same butterflies as g_fft::bfstages / ibfstages, but
+// several butterflies at a time, one per vector lane pair.  Adjacent
+// butterflies of a stage use adjacent data and different twiddle factors,
+// so g_fft lays the twiddles of each stage out in a scratch table first,
+// with the forward / inverse sign already applied.
+//
+// The kernels are written with the GCC vector extensions, so the same code
+// becomes SSE2 or NEON code for 128 bit vectors, and AVX code when built
+// for the 256 bit backend, see simd.h.  The 256 bit backend is chosen at
+// run time when the CPU supports AVX2.  Define GFFT_NO_SIMD to use the
+// scalar stages only in g_fft, or NO_SIMD for all of the vector kernels.
+//==============================================================================
+
+#ifndef GFFT_SIMD_H
+#define GFFT_SIMD_H
+
+#include "simd.h"
+
+#if defined(SIMD_VECTORS) && !defined(GFFT_NO_SIMD)
+#  define GFFT_HAVE_SIMD 1
+#  ifdef SIMD_AVX2
+#    define GFFT_HAVE_AVX2 1
+#  endif
+#endif
+
+// number of twiddle kinds per butterfly, see g_fft::simd_twiddles
+#define GFFT_SIMD_TWIDDLES 7
+
+template <typename FFT_TYPE>
+struct gfft_simd {
+	typedef void (*radix8_fn)(FFT_TYPE *ioptr, unsigned int NDiffU,
+				unsigned int NSameU, unsigned int pinc, const FFT_TYPE *tw);
+// the kernel for the widest vectors of at most width bits that the cpu can
+// run, or 0 for the scalar stages; lanes is the number of complex values
+// per vector.  There are no vector kernels for this type.
+	static radix8_fn select(int &lanes, int width = 256) { lanes = 0; return 0; }
+};
+
+#ifdef GFFT_HAVE_SIMD
+
+//------------------------------------------------------------------------------
+// One radix 8 stage
+//   V       vector of complex values, interleaved real / imaginary
+//   VI      integer vector used to swap real and imaginary parts
+//   ioptr   data, interleaved real / imaginary
+//   NDiffU  butterflies with different twiddles (adjacent in memory)
+//   NSameU  butterflies with the same twiddles (pinc * 8 apart)
+//   tw      for each twiddle kind, 2 * NDiffU values of duplicated real
+//           parts followed by 2 * NDiffU values of (-imag, imag) pairs
+//------------------------------------------------------------------------------
+// the data of a g_fft is only aligned to its element type
+template <typename V, typename FFT_TYPE>
+static inline __attribute__((always_inline))
+void gfft_simd_load(V &v, const FFT_TYPE *p)
+{
+	__builtin_memcpy(&v, p, sizeof(V));
+}
+
+template <typename V, typename FFT_TYPE>
+static inline __attribute__((always_inline))
+void gfft_simd_store(FFT_TYPE *p, const V &v)
+{
+	__builtin_memcpy(p, &v, sizeof(V));
+}
+
+template <typename V, typename VI, typename FFT_TYPE, int LANES>
+static inline __attribute__((always_inline))
+void gfft_radix8_stage(FFT_TYPE *ioptr, unsigned int NDiffU, unsigned int NSameU,
+			unsigned int pinc, const FFT_TYPE *tw)
+{
+	const unsigned int pos = pinc * 4;
+	const unsigned int pnext = pinc * 8;
+	const unsigned int twlen = 2 * NDiffU;
+	const V Two = V() + FFT_TYPE(2.0);
+
+	VI swapidx;
+	for (int i = 0; i < 2 * LANES; i++)
+		swapidx[i] = i ^ 1;
+
+#define GFFT_LD(v, p)	gfft_simd_load(v, p)
+#define GFFT_ST(p, v)	gfft_simd_store(p, v)
+// complex multiply by the twiddle pair (wr, wi)
+#define GFFT_MUL(x, wr, wi)	((x) * (wr) + __builtin_shuffle((x), swapidx) * (wi))
+
+	for (unsigned int d = 0; d < 2 * NDiffU; d += 2 * LANES) {
+		V w0r, w0i, w1r, w1i, jw1r, jw1i, w2r, w2i, jw2r, jw2i, w3r, w3i, jw3r, jw3i;
+		GFFT_LD(w0r,  tw +  0 * twlen + d); GFFT_LD(w0i,  tw +  1 * twlen + d);
+		GFFT_LD(w1r,  tw +  2 * twlen + d); GFFT_LD(w1i,  tw +  3 * twlen + d);
+		GFFT_LD(jw1r, tw +  4 * twlen + d); GFFT_LD(jw1i, tw +  5 * twlen + d);
+		GFFT_LD(w2r,  tw +  6 * twlen + d); GFFT_LD(w2i,  tw +  7 * twlen + d);
+		GFFT_LD(jw2r, tw +  8 * twlen + d); GFFT_LD(jw2i, tw +  9 * twlen + d);
+		GFFT_LD(w3r,  tw + 10 * twlen + d); GFFT_LD(w3i,  tw + 11 * twlen + d);
+		GFFT_LD(jw3r, tw + 12 * twlen + d); GFFT_LD(jw3i, tw + 13 * twlen + d);
+
+		FFT_TYPE *p0 = ioptr + d;
+		for (unsigned int s = NSameU; s > 0; s--, p0 += pnext) {
+			FFT_TYPE *p1 = p0 + pinc;
+			FFT_TYPE *p2 = p1 + pinc;
+			FFT_TYPE *p3 = p2 + pinc;
+			V f0, f1, f2, f3, f4, f5, f6, f7;
+			GFFT_LD(f0, p0); GFFT_LD(f1, p1); GFFT_LD(f2, p2); GFFT_LD(f3, p3);
+			GFFT_LD(f4, p0 + pos); GFFT_LD(f5, p1 + pos);
+			GFFT_LD(f6, p2 + pos); GFFT_LD(f7, p3 + pos);
+			V t0, t1;
+
+			t0 = f0 + GFFT_MUL(f1, w0r, w0i);
+			f1 = f0 * Two - t0;
+			t1 = f2 - GFFT_MUL(f3, w0r, w0i);
+			f2 = f2 * Two - t1;
+			f0 = t0 + GFFT_MUL(f2, w1r, w1i);
+			f2 = t0 * Two - f0;
+			f3 = f1 + GFFT_MUL(t1, jw1r, jw1i);
+			f1 = f1 * Two - f3;
+
+			t0 = f4 + GFFT_MUL(f5, w0r, w0i);
+			f5 = f4 * Two - t0;
+			t1 = f6 - GFFT_MUL(f7, w0r, w0i);
+			f6 = f6 * Two - t1;
+			f4 = t0 + GFFT_MUL(f6, w1r, w1i);
+			f6 = t0 * Two - f4;
+			f7 = f5 + GFFT_MUL(t1, jw1r, jw1i);
+			f5 = f5 * Two - f7;
+
+			t0 = f0 - GFFT_MUL(f4, w2r, w2i);
+			f0 = f0 * Two - t0;
+			t1 = f1 - GFFT_MUL(f5, w3r, w3i);
+			f1 = f1 * Two - t1;
+			GFFT_ST(p0 + pos, t0);
+			GFFT_ST(p1 + pos, t1);
+			GFFT_ST(p0, f0);
+			GFFT_ST(p1, f1);
+
+			f4 = f2 - GFFT_MUL(f6, jw2r, jw2i);
+			f6 = f2 * Two - f4;
+			f5 = f3 - GFFT_MUL(f7, jw3r, jw3i);
+			f7 = f3 * Two - f5;
+			GFFT_ST(p2, f4);
+			GFFT_ST(p3, f5);
+			GFFT_ST(p2 + pos, f6);
+			GFFT_ST(p3 + pos, f7);
+		}
+	}
+
+#undef GFFT_LD
+#undef GFFT_ST
+#undef GFFT_MUL
+}
+
+template <>
+struct gfft_simd<double> {
+	typedef double v2d __attribute__((vector_size(16)));
+	typedef long long v2i __attribute__((vector_size(16)));
+	typedef double v4d __attribute__((vector_size(32)));
+	typedef long long v4i __attribute__((vector_size(32)));
+	typedef void (*radix8_fn)(double *ioptr, unsigned int NDiffU,
+				unsigned int NSameU, unsigned int pinc, const double *tw);
+
+	static void radix8_128(double *ioptr, unsigned int NDiffU, unsigned int NSameU,
+				unsigned int pinc, const double *tw) {
+		gfft_radix8_stage<v2d, v2i, double, 1>(ioptr, NDiffU, NSameU, pinc, tw);
+	}
+#ifdef GFFT_HAVE_AVX2
+	__attribute__((target("avx2")))
+	static void radix8_256(double *ioptr, unsigned int NDiffU, unsigned int NSameU,
+				unsigned int pinc, const double *tw) {
+		gfft_radix8_stage<v4d, v4i, double, 2>(ioptr, NDiffU, NSameU, pinc, tw);
+	}
+#endif
+	static radix8_fn select(int &lanes, int width = 256) {
+#ifdef GFFT_HAVE_AVX2
+		if (width >= 256 && simd_have_avx2()) {
+			lanes = 2;
+			return radix8_256;
+		}
+#endif
+		lanes = width >= 128 ? 1 : 0;
+		return width >= 128 ? radix8_128 : 0;
+	}
+};
+
+template <>
+struct gfft_simd<float> {
+	typedef float v4f __attribute__((vector_size(16)));
+	typedef int v4i __attribute__((vector_size(16)));
+	typedef float v8f __attribute__((vector_size(32)));
+	typedef int v8i __attribute__((vector_size(32)));
+	typedef void (*radix8_fn)(float *ioptr, unsigned int NDiffU,
+				unsigned int NSameU, unsigned int pinc, const float *tw);
+
+	static void radix8_128(float *ioptr, unsigned int NDiffU, unsigned int NSameU,
+				unsigned int pinc, const float *tw) {
+		gfft_radix8_stage<v4f, v4i, float, 2>(ioptr, NDiffU, NSameU, pinc, tw);
+	}
+#ifdef GFFT_HAVE_AVX2
+	__attribute__((target("avx2")))
+	static void radix8_256(float *ioptr, unsigned int NDiffU, unsigned int NSameU,
+				unsigned int pinc, const float *tw) {
+		gfft_radix8_stage<v8f, v8i, float, 4>(ioptr, NDiffU, NSameU, pinc, tw);
+	}
+#endif
+	static radix8_fn select(int &lanes, int width = 256) {
+#ifdef GFFT_HAVE_AVX2
+		if (width >= 256 && simd_have_avx2()) {
+			lanes = 4;
+			return radix8_256;
+		}
+#endif
+		lanes = width >= 128 ? 2 : 0;
+		return width >= 128 ? radix8_128 : 0;
+	}
+};
+
+#endif // GFFT_HAVE_SIMD
+
+#endif
@@ -8,6 +8,8 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <math.h>
+#include <unistd.h>
+#include <pthread.h>
 
 #include "pj_struc.h"
 #include "pj_fht.h"
@@ -1986,18 +1988,45 @@ private:
 // buffer for decoded characters
 	FIFO<uint8_t> Output;
 
+// decoder results of the current symbol, one per decoder,
+// merged into the sync integrators in decoder order
+	uint64_t *DecodedBlock;
+	float	*DecodedSignal;
+	float	*DecodedNoiseEnergy;
+
+// worker threads, the decoders of one symbol are split in contiguous
+// ranges and range 0 is decoded by the calling thread
+	const static size_t MaxWorkers = 4;
+	const static size_t MinDecodersPerWorker = 32;
+	size_t Workers;
+	pthread_t WorkerThread[MaxWorkers];
+	pthread_mutex_t WorkMutex;
+	pthread_cond_t WorkStart;
+	pthread_cond_t WorkDone;
+	unsigned int WorkGen;
+	bool	WorkExit;
+	size_t WorkRanges;
+	size_t WorkNext;
+	size_t WorkPending;
+	size_t WorkRange[MaxWorkers + 1];
+
 public:
 	MFSK_Receiver() {
 			bContestia = false;
 			Init();
 			Default();
+			StartWorkers();
 	}
 	~MFSK_Receiver() {
+			StopWorkers();
 			Free();
 	}
 	void Init(void) {
 			Decoder = 0;
 			DecodePipe = 0;
+			DecodedBlock = 0;
+			DecodedSignal = 0;
+			DecodedNoiseEnergy = 0;
 	}
 	void Free(void) {
 			if (Decoder) {
@@ -2006,6 +2035,9 @@ public:
 					Decoder[Idx].Free();
 				free(Decoder); Decoder=0;
 			}
+			free(DecodedBlock); DecodedBlock = 0;
+			free(DecodedSignal); DecodedSignal = 0;
+			free(DecodedNoiseEnergy); DecodedNoiseEnergy = 0;
 			if (DecodePipe) {
 				size_t Idx;
 				for (Idx = 0; Idx < BlockPhases; Idx++)
@@ -2099,6 +2131,13 @@ public:
 			for (Idx = 0; Idx < (SlicesPerSymbol * FreqOffsets); Idx++)
 				if (Decoder[Idx].Preset(RefDecoder) < 0) goto Error;
 
+			if (ReallocArray(&DecodedBlock, SlicesPerSymbol * FreqOffsets) < 0)
+				goto Error;
+			if (ReallocArray(&DecodedSignal, SlicesPerSymbol * FreqOffsets) < 0)
+				goto Error;
+			if (ReallocArray(&DecodedNoiseEnergy, SlicesPerSymbol * FreqOffsets) < 0)
+				goto Error;
+
 			if (ReallocArray(&DecodePipe,BlockPhases) < 0) goto Error;
 			for (Idx = 0; Idx < BlockPhases; Idx++)
 				DecodePipe[Idx].Init();
@@ -2257,6 +2296,117 @@ Sync. S/N threshold = %3.1f\n",
 	}
 
 private:
+// one worker per processor, up to MaxWorkers
+	void StartWorkers(void) {
+			Workers = 1;
+#ifdef _SC_NPROCESSORS_ONLN
+			long CPUs = sysconf(_SC_NPROCESSORS_ONLN);
+			if (CPUs > 1)
+				Workers = CPUs < (long)MaxWorkers ? (size_t)CPUs : MaxWorkers;
+#endif
+			WorkGen = 0;
+			WorkExit = false;
+			WorkRanges = WorkNext = WorkPending = 0;
+			pthread_mutex_init(&WorkMutex, NULL);
+			pthread_cond_init(&WorkStart, NULL);
+			pthread_cond_init(&WorkDone, NULL);
+			for (size_t Idx = 1; Idx < Workers; Idx++) {
+				if (pthread_create(&WorkerThread[Idx], NULL, WorkerLoop, this) != 0) {
+					Workers = Idx;
+					break;
+				}
+			}
+	}
+
+	void StopWorkers(void) {
+			pthread_mutex_lock(&WorkMutex);
+			WorkExit = true;
+			WorkGen++;
+			pthread_cond_broadcast(&WorkStart);
+			pthread_mutex_unlock(&WorkMutex);
+			for (size_t Idx = 1; Idx < Workers; Idx++)
+				pthread_join(WorkerThread[Idx], NULL);
+			pthread_cond_destroy(&WorkDone);
+			pthread_cond_destroy(&WorkStart);
+			pthread_mutex_destroy(&WorkMutex);
+	}
+
+	static void *WorkerLoop(void *Arg) {
+			MFSK_Receiver<Type> *Rx = static_cast<MFSK_Receiver<Type> *>(Arg);
+			unsigned int Gen = 0;
+			size_t Range;
+
+			pthread_mutex_lock(&Rx->WorkMutex);
+			for (;;) {
+				while (Rx->WorkGen == Gen)
+					pthread_cond_wait(&Rx->WorkStart, &Rx->WorkMutex);
+				Gen = Rx->WorkGen;
+				if (Rx->WorkExit)
+					break;
+				while (Rx->WorkNext < Rx->WorkRanges) {
+					Range = Rx->WorkNext++;
+					pthread_mutex_unlock(&Rx->WorkMutex);
+
+					Rx->DecodeRange(Rx->WorkRange[Range], Rx->WorkRange[Range + 1]);
+
+					pthread_mutex_lock(&Rx->WorkMutex);
+					if (--Rx->WorkPending == 0)
+						pthread_cond_signal(&Rx->WorkDone);
+				}
+			}
+			pthread_mutex_unlock(&Rx->WorkMutex);
+			return NULL;
+	}
+
+// run the decoders [First, Last) on the current symbol,
+// the decoders only read the demodulator and write their own results
+	void DecodeRange(size_t First, size_t Last) {
+			Type Symbol[8];
+			size_t Idx;
+			for (Idx = First; Idx < Last; Idx++) {
+				size_t Slice = Idx / FreqOffsets;
+				size_t Offset = Idx % FreqOffsets;
+				Demodulator.SoftDecode(Symbol, Slice, (int)Offset - (FreqOffsets / 2));
+
+				Decoder[Idx].Input(Symbol);
+				Decoder[Idx].Process();
+				Decoder[Idx].Output(DecodedBlock + Idx);
+
+				DecodedSignal[Idx] = Decoder[Idx].Signal;
+				DecodedNoiseEnergy[Idx] = Decoder[Idx].NoiseEnergy;
+			}
+	}
+
+	void DecodeSymbol(void) {
+			size_t Decoders = SlicesPerSymbol * FreqOffsets;
+			size_t Ranges = Workers;
+// small searches are not worth waking the other threads
+			if (Decoders < MinDecodersPerWorker * Ranges)
+				Ranges = Decoders / MinDecodersPerWorker;
+			if (Ranges < 2) {
+				DecodeRange(0, Decoders);
+				return;
+			}
+
+			for (size_t Idx = 0; Idx <= Ranges; Idx++)
+				WorkRange[Idx] = (Decoders * Idx) / Ranges;
+
+			pthread_mutex_lock(&WorkMutex);
+			WorkRanges = Ranges;
+			WorkNext = 1;
+			WorkPending = Ranges - 1;
+			WorkGen++;
+			pthread_cond_broadcast(&WorkStart);
+			pthread_mutex_unlock(&WorkMutex);
+
+			DecodeRange(WorkRange[0], WorkRange[1]);
+
+			pthread_mutex_lock(&WorkMutex);
+			while (WorkPending)
+				pthread_cond_wait(&WorkDone, &WorkMutex);
+			pthread_mutex_unlock(&WorkMutex);
+	}
+
 // process the input buffer: first the input processor, then the demodulator
 	void ProcessInputBuffer(void) {
 			while(InputBuffer.Len >= InputProcessor.WindowLen) {
@@ -2275,7 +2425,8 @@ private:
 	template <class InpType>
 	void ProcessSymbol(InpType *Input) {
 			Demodulator.Process(Input);
-			MFSK_SoftDecoder<Type,Type> *DecoderPtr = Decoder;
+			DecodeSymbol();
+			size_t DecoderIdx = 0;
 
 			size_t Offset,Slice;
 			for (Slice = 0; Slice < SlicesPerSymbol; Slice++) {
@@ -2290,19 +2441,14 @@ private:
 				Type	BestSliceSignal = 0;
 				Type	NoiseEnergy = 0;
 				Type	Signal;
-				Type	Symbol[8];
 
 				for (Offset = 0; Offset < FreqOffsets; Offset++) {
-					Demodulator.SoftDecode(Symbol, Slice, (int)Offset - (FreqOffsets / 2));
-
-					DecoderPtr->Input(Symbol);
-					DecoderPtr->Process();
-					DecoderPtr->Output(DecodeBlockPtr);
+					*DecodeBlockPtr = DecodedBlock[DecoderIdx];
 
-					NoiseEnergy = DecoderPtr->NoiseEnergy;
+					NoiseEnergy = DecodedNoiseEnergy[DecoderIdx];
 					NoiseEnergyPtr->Process(NoiseEnergy, SyncFilterWeight);
 
-					Signal = DecoderPtr->Signal;
+					Signal = DecodedSignal[DecoderIdx];
 					SignalPtr->Process(Signal, SyncFilterWeight);
 					Signal = SignalPtr->Output;
 
@@ -2311,7 +2457,7 @@ private:
 							BestSliceOffset = Offset;
 					}
 
-					DecoderPtr++;
+					DecoderIdx++;
 					DecodeBlockPtr++;
 
 					NoiseEnergyPtr++;
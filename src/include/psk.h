@@ -49,6 +49,7 @@
 #define GOERTZEL 288		//96 x 2 must be an integer value
 
 #define MAX_CARRIERS 32
+#define PSK_MIXBLOCK 64
 
 //=====================================================================
 
@@ -68,6 +69,14 @@ private:
 	double 			inter_carrier; // Frequency gap betweeb carriers
 
 // rx variables & functions
+// carrier bank NCO, unit phasors stepped once per sample
+	double			rxnco_i[MAX_CARRIERS];
+	double			rxnco_q[MAX_CARRIERS];
+	double			rxstep_i[MAX_CARRIERS];
+	double			rxstep_q[MAX_CARRIERS];
+	double			rxstep_freq;
+	cmplx			rxmix[MAX_CARRIERS][PSK_MIXBLOCK];
+	cmplx			rxdec[MAX_CARRIERS][PSK_MIXBLOCK];
 	C_FIR_filter		*fir1[MAX_CARRIERS];
 	C_FIR_filter		*fir2[MAX_CARRIERS];
 //	C_FIR_filter		*fir3;
@@ -118,6 +127,7 @@ private:
 	viewpsk*		pskviewer;
 	pskeval*		evalpsk;
 
+	void			rx_mix(const double *buf, int n);
 	void			rx_symbol(cmplx symbol, int car);
 	void 			rx_bit(int bit);
 	void 			rx_bit2(int bit);
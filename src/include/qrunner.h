@@ -29,6 +29,7 @@
 #endif
 
 #include <unistd.h>
+#include <stdint.h>
 #include <cerrno>
 #include <stdexcept>
 #include <cstring>
@@ -58,6 +59,14 @@ namespace qrbind {
 #  define QRUNNER_WRITE(fd__, buf__, len__) send(fd__, (const char*)buf__, len__, 0)
 #endif
 
+// the main thread is woken through an eventfd where we have one, which
+// takes a 64 bit counter, and through a pipe or socket pair elsewhere
+#if HAVE_SYS_EVENTFD_H
+#  define QRUNNER_WAKEUP_SIZE 8
+#else
+#  define QRUNNER_WAKEUP_SIZE 1
+#endif
+
 class qexception : public std::exception
 {
 public:
@@ -103,12 +112,7 @@ public:
         bool request(const F& f)
         {
                 if (fifo->push(f)) {
-#ifdef NDEBUG
-                        if (unlikely(QRUNNER_WRITE(pfd[1], "", 1) != 1))
-                                throw qexception(errno);
-#else
-                        assert(QRUNNER_WRITE(pfd[1], "", 1) == 1);
-#endif
+                        wakeup();
                         return true;
                 }
 
@@ -151,10 +155,28 @@ public:
 
         void drop(void) { fifo->drop(); }
         size_t size(void) { return fifo->size(); }
+        void stats(fqueue::stats_t& st) { fifo->stats(st); }
 
 protected:
+        // Only the first request after the main thread has started to run
+        // the queue writes to the wakeup fd, the others find wake_pending set.
+        void wakeup(void)
+        {
+                static const uint64_t one = 1;
+
+                if (__sync_lock_test_and_set(&wake_pending, 1))
+                        return;
+#ifdef NDEBUG
+                if (unlikely(QRUNNER_WRITE(pfd[1], &one, QRUNNER_WAKEUP_SIZE) != QRUNNER_WAKEUP_SIZE))
+                        throw qexception(errno);
+#else
+                assert(QRUNNER_WRITE(pfd[1], &one, QRUNNER_WAKEUP_SIZE) == QRUNNER_WAKEUP_SIZE);
+#endif
+        }
+
         fqueue *fifo;
         int pfd[2];
+        volatile int wake_pending;
         bool attached;
 	bool inprog;
 public:
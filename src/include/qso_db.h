@@ -4,6 +4,8 @@
 #include <iosfwd>
 #include <string>
 #include <cstring>
+#include <vector>
+#include <tr1/unordered_map>
 
 #include "adif_def.h"
 
@@ -64,6 +66,14 @@ private:
 	int maxrecs;
 	int nbrrecs;
 	int dirty;
+
+// records by lower case callsign, with the frequency and date / time compared
+// by duplicate; made when needed, and dropped by any change to the records
+	tr1::unordered_map<string, vector<int> > callidx;
+	vector<int> recfreq;
+	vector<unsigned long> recdatetime;
+	bool indexed;
+	void make_index();
 	
 	static const int jdays[][13];
 	bool isleapyear( int y ) const;
@@ -43,9 +43,11 @@
 
 #include <string>
 
+#include <pthread.h>
 #include <samplerate.h>
 
 #include "ringbuffer.h"
+#include "bcastbuffer.h"
 #include "globals.h"
 #include "modem.h"
 #include "gfft.h"
@@ -61,6 +63,13 @@
 #define RSID_NTIMES      (RSID_NSYMBOLS * 2)
 #define RSID_PRECISION   2.7 // detected frequency precision in Hz
 
+// audio tap between the trx thread and the rsid thread, about 1.4 seconds
+// at 48000 samples per second
+#define RSID_TAP_SIZE		65536
+#define RSID_TAP_BLOCK		2048
+// maximum number of sub-bands searched in parallel
+#define RSID_MAX_BANDS		4
+
 // each rsid symbol has a duration equal to 1024 samples at 11025 Hz smpl rate
 #define RSID_SYMLEN		(1024.0 / RSID_SAMPLE_RATE) // 0.09288 // duration of each rsid symbol
 
@@ -70,7 +79,12 @@ enum {
 	RSID_BANDWIDTH_WIDE,
 };
 
+// float halves the fft cost, build with -DRSID_FFT_FLOAT
+#ifdef RSID_FFT_FLOAT
+typedef float rs_fft_type;
+#else
 typedef double rs_fft_type;
+#endif
 typedef std::complex<rs_fft_type> rs_cpx_type;
 
 struct RSIDs { unsigned short rs; trx_mode mode; const char* name; };
@@ -123,6 +137,40 @@ private:
 	int		iPrevBin2;
 	int		iPrevSymbol2;
 
+// search sub-bands, band 0 is searched by the rsid thread itself
+	struct rsband {
+		int		lo, hi;
+		int		distance, code, bin;
+	};
+	rsband			bands[RSID_MAX_BANDS];
+	int				nbands;
+	pthread_t		band_thread[RSID_MAX_BANDS];
+	pthread_mutex_t	band_mutex;
+	pthread_cond_t	band_start;
+	pthread_cond_t	band_done;
+	unsigned int	band_gen;
+	int				band_count;
+	int				bands_next;
+	int				bands_pending;
+	const unsigned char	*band_codes;
+	int				band_tblsize;
+
+// audio tap, written by the trx thread and read by the rsid thread
+	bcastbuffer<float>	tap;
+	bcastbuffer<float>::reader	tapreader;
+	pthread_t		rx_thread;
+	pthread_mutex_t	rx_mutex;
+	pthread_cond_t	rx_cond;
+	volatile bool	rx_exit;
+	volatile bool	flush_request;
+// rx parameters of the trx thread, taken with each block
+	volatile double	rx_samplerate;
+	volatile double	rx_centerfreq;
+	volatile bool	rx_reverse;
+// trx samples written to and consumed from the tap
+	volatile unsigned long long	tap_count;
+	unsigned long long	sample_pos;
+
 // resample
 	SRC_STATE* 	src_state;
 	SRC_DATA	src_data;
@@ -137,23 +185,30 @@ private:
 
 private:
 	void	Encode(int code, unsigned char *rsid);
+	void	process(const float* buf, size_t len);
 	void	search(void);
 	void	setup_mode(int m);
 
 	void	CalculateBuckets(const rs_fft_type *pSpectrum, int iBegin, int iEnd);
 	inline int		HammingDistance(int iBucket, unsigned char *p2);
 	bool	search_amp( int &bin_out, int &symbol_out, unsigned char *pcode_table );
-	void	apply ( int iBin, int iSymbol, int extended );
+	void	search_band(rsband &band);
+	void	apply ( int iBin, int iSymbol, int extended, unsigned long long sample );
+
+	static void	*rx_loop(void *arg);
+	static void	*band_loop(void *arg);
 
 public:
 	cRsId();
 	~cRsId();
 	void	reset();
 	void	receive(const float* buf, size_t len);
+	void	flush_modem();
 	void	send(bool postidle);
 	bool	assigned(trx_mode mode);
 
 friend void reset_rsid(void *who);
+friend void rsid_detected(int iBin, int iSymbol, int extended, unsigned long long sample);
 };
 
 #endif
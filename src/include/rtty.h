@@ -43,6 +43,7 @@
 //#define RTTY_SampleRate 12000
 
 #define MAXPIPE			1024
+#define RTTY_FILTLEN	1024
 #define MAXBITS			(2 * RTTY_SampleRate / 23 + 1)
 
 #define	LETTERS	0x100
@@ -155,10 +156,18 @@ private:
 
 	bool		bit_buf[MAXBITS];
 
-	double mark_phase;
-	double space_phase;
+// mark and space oscillators, rotated by one sample step per sample
+	cmplx mark_nco;
+	cmplx space_nco;
+	cmplx mark_rot;
+	cmplx space_rot;
+	double nco_freq;
+	double nco_shift;
 	fftfilt *mark_filt;
 	fftfilt *space_filt;
+	cmplx rx_in[RTTY_FILTLEN / 2];
+	cmplx mark_out[RTTY_FILTLEN / 2];
+	cmplx space_out[RTTY_FILTLEN / 2];
 
 	double *pipe;
 	double *dsppipe;
@@ -217,7 +226,6 @@ private:
 	void Update_syncscope();
 
 	double IF_freq;
-	inline cmplx mixer(double &phase, double f, cmplx in);
 
 	unsigned char Bit_reverse(unsigned char in, int n);
 	int decode_char();
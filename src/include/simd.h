@@ -0,0 +1,54 @@
+//==============================================================================
+// simd.h:
+//
+// Compiler and cpu support for the vector kernels
+//
+// This file is part of fldigi.
+//
+// Fldigi is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Fldigi is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with fldigi.  If not, see <http://www.gnu.org/licenses/>.
+//==============================================================================
+//==============================================================================
+// The g_fft stages, the sfft bin update, the psk carrier mixer, the viterbi
+// add-compare-select and the waterfall dB conversion are written with the
+// GCC vector extensions, which need gcc 4.9 or later for __builtin_shuffle
+// and the vector conversions they use.  The same code becomes SSE2 or NEON
+// code for 128 bit vectors.
+//
+// SIMD_VECTORS     the vector kernels are built
+// SIMD_AVX2        256 bit kernels are also built, with target("avx2"),
+//                  and simd_have_avx2() tells whether the cpu can run them
+//
+// Define NO_SIMD to build the scalar code only.
+//==============================================================================
+
+#ifndef SIMD_H
+#define SIMD_H
+
+#if defined(__GNUC__) && !defined(__clang__) && !defined(NO_SIMD) && \
+	((__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#  define SIMD_VECTORS 1
+#  if defined(__x86_64__) || defined(__i386__)
+#    define SIMD_AVX2 1
+#  endif
+#endif
+
+#ifdef SIMD_AVX2
+static inline bool simd_have_avx2(void)
+{
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2");
+}
+#endif
+
+#endif
@@ -0,0 +1,108 @@
+// ----------------------------------------------------------------------------
+// spectrum.h
+//
+// Power spectrum frames published by the waterfall for the modems.
+//
+// The waterfall publishes each power spectrum it computes as a new frame
+// with a new version number.  The frames are kept in a small ring and are
+// not changed after they have been published, until the writer comes
+// around to reuse the slot.  A reader takes a snapshot of the newest frame,
+// makes all of its queries on it and then checks once that the frame still
+// has the same version, and starts again with a new snapshot if it does not:
+//
+//	for (;;) {
+//		spectrum::snapshot s(*spec);
+//		sp = s.peak(lo, hi);
+//		np = s.power(f);
+//		if (s.valid())
+//			break;
+//	}
+//
+// The results of an invalid snapshot may be garbage and must not be used.
+// The writer never waits for the readers and the readers take no lock.
+//
+// Each frame holds prefix sums and a table of range maxima of the power,
+// so that band power and band peak queries take the same time for any
+// bandwidth.
+//
+// This file is part of fldigi.
+//
+// Fldigi is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Fldigi is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with fldigi.  If not, see <http://www.gnu.org/licenses/>.
+// ----------------------------------------------------------------------------
+
+#ifndef SPECTRUM_H
+#define SPECTRUM_H
+
+#define SPECTRUM_FRAMES 3
+
+class spectrum
+{
+	struct frame;
+
+public:
+	spectrum(int bins);
+	~spectrum();
+
+// writer, one thread only; pwr has one value per Hz
+	void publish(const double *pwr);
+	void publish(const float *pwr);
+
+	class snapshot
+	{
+	public:
+		snapshot(spectrum &s);
+	// true if the frame was not reused during the queries
+		bool valid(void);
+
+	// power of bin i, 0 for the DC bin as in WFdisp::Pwr
+		double power(int i);
+	// power of the bins lo .. hi, summed or the largest; the band
+	// queries include the DC bin as WFdisp::powerDensity always did
+		double sum(int lo, int hi);
+		double peak(int lo, int hi);
+	// average power of the bins from f0 - bw/2 to f0 + bw/2
+		double density(double f0, double bw);
+
+	private:
+		spectrum &spec;
+		const frame *f;
+		unsigned int v;
+	};
+	friend class snapshot;
+
+// readers, any thread, for a single query
+	unsigned int version(void) { return latest; }
+	double power(int i);
+	double density(double f0, double bw);
+
+private:
+	struct frame {
+		volatile unsigned int version; // 0 while it is being written
+		double *pwr;
+		double *prefix; // prefix[i] = pwr[0] + ... + pwr[i - 1]
+		double **max;   // max[k][i] = largest of pwr[i] .. pwr[i + 2^k - 1]
+	};
+
+	template <typename T> void publish_frame(const T *pwr);
+
+	int nbins;
+	int nlevels;
+	int *log2tab;  // floor(log2(n))
+	frame frames[SPECTRUM_FRAMES];
+	volatile unsigned int latest;
+
+	bool clip(int &lo, int &hi);
+};
+
+#endif // SPECTRUM_H
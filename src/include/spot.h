@@ -35,7 +35,10 @@ typedef void (*spot_recv_cb_t)(trx_mode mode, int afreq, const char* str, const
 typedef void (*spot_log_cb_t)(const char* call, const char* loc, long long freq,
 			      trx_mode mode, time_t rtime, void* data);
 
-void spot_recv(char c, int decoder = -1, int afreq = 0, int md = 0);
+// flush is called once before the first callback for c, if any is made
+typedef void (*spot_flush_t)(void);
+
+void spot_recv(char c, int decoder = -1, int afreq = 0, int md = 0, spot_flush_t flush = NULL);
 void spot_log(const char* callsign, const char* locator = "", long long freq = 0LL,
 	      trx_mode mode = NUM_MODES, time_t rtime = -1L);
 void spot_manual(const char* callsign, const char* locator = "",
@@ -1,5 +1,6 @@
 
 #include <time.h>
+#include <pthread.h>
 
 #ifndef _SSDV_RX_H
 #define _SSDV_RX_H
@@ -11,6 +12,7 @@
 #include <FL/Fl_Scroll.H>
 
 #include "ssdv.h"
+#include "ringbuffer.h"
 
 class ssdv_rx : public Fl_Double_Window
 {
@@ -30,6 +32,36 @@ private:
 	
 	Fl_Progress *flprogress;
 	
+	/* Displayed image, owned by the main thread */
+	uint8_t *image;
+	size_t image_len;
+	int display_width;
+	int display_height;
+	
+	/* Received bytes are queued by the modem and decoded by the worker
+	 * thread, which posts an update to the main thread per packet */
+	struct rx_byte {
+		uint8_t byte;
+		int lost;
+	};
+	static const int RXQ_SIZE = 4096;
+	
+	ringbuffer<rx_byte> *rxq;
+	int rxq_lost;
+	pthread_t rx_thread;
+	pthread_mutex_t rx_mutex;
+	pthread_cond_t rx_cond;
+	volatile bool rx_exit;
+	
+	/* Set while the decoder thread works on bytes taken from rxq,
+	 * rx_idle is signalled when it has run out of bytes */
+	bool rx_busy;
+	pthread_cond_t rx_idle;
+	
+	struct update;
+	
+	/* Everything below is owned by the worker thread */
+	
 	/* RX buffer */
 	static const int BUFFER_SIZE = SSDV_PKT_SIZE * 2;
 	
@@ -38,11 +70,19 @@ private:
 	int bc;
 	int bl;
 	
+	/* Rolling CRC over the CRC-covered part of the buffer window */
+	uint32_t sync_crc;
+	bool sync_crc_valid;
+	
+	/* Bytes received since the last decoded packet, -1 before the first,
+	 * and the callsign and image ID bytes of that packet */
+	long pkt_bytes;
+	uint8_t pkt_header[5];
+	
 	/* Packet and RGB image buffer */
 	uint8_t *packets;
 	int packets_len;
-	uint8_t *image;
-	size_t image_len;
+	uint8_t *work_image;
 	
 	/* Last packet details */
 	ssdv_packet_info_t pkt_info;
@@ -59,17 +99,24 @@ private:
 	int image_errors;
 	
 	/* Private functions */
+	static void *rx_loop(void *arg);
+	void process_byte(uint8_t byte, int lost);
+	void show_update(update *u);
 	void feed_buffer(uint8_t byte, uint8_t erasure);
 	void clear_buffer();
+	void update_sync_crc();
+	bool is_sync_candidate();
 	void upload_packet(int fixes);
 	void save_image(uint8_t *jpeg, size_t length);
-	void render_image(uint8_t *jpeg, size_t length);
+	void packet_mcu_range(int packet_id, int mcu_count, int *mcu_start, int *mcu_end);
+	bool render_image(uint8_t *jpeg, size_t length, int mcu_start, int mcu_end, int *y0, int *y1);
 	
 public:
 	ssdv_rx(int w, int h, const char *title);
 	~ssdv_rx();
 	
 	void put_byte(uint8_t byte, int lost);
+	void wait_idle();
 };
 
 #endif
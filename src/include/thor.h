@@ -66,6 +66,9 @@
 // created
 #define MAXPATHS (8 * THORFASTPATHS * THORNUMTONES )
 
+// pipe entries 1 .. THORCWITESTS are checked for CWI by harddecode
+#define THORCWITESTS 10
+
 struct THORrxpipe {
 	cmplx vector[THORMAXFFTS * THORNUMTONES * 6];
 };
@@ -105,6 +108,13 @@ protected:
 	
 	THORrxpipe		*pipe;
 	unsigned int	pipeptr;
+	unsigned int	pipepass;
+// bin magnitudes of the current symbol, and of the pipe entries used by
+// the CWI test with the pass of the pipe they were taken in
+	double			binmag[MAXPATHS];
+	double			cwimag[THORCWITESTS][MAXPATHS];
+	unsigned int	cwipass[THORCWITESTS];
+	bool			cwivalid[THORCWITESTS];
 	unsigned int	datashreg;
 	mbuffer<double, 0, 2>	scopedata;
 	mbuffer<double, 0, 2>	videodata;
@@ -161,6 +171,8 @@ private:
 	void	recvchar(int c);
 	void	decodesymbol();
 	void	softdecodesymbol();
+	void	binmags();
+	const double *cwimags(int j);
 	int		harddecode();
 	int		softdecode();
 	void	update_syncscope();
@@ -48,18 +48,12 @@ struct RTTY_CHANNEL {
 
 	double			phaseacc;
 
-	fftfilt *mark_filt;
-	fftfilt *space_filt;
-
 	Cmovavg		*bits;
 	bool		nubit;
 	bool		bit;
 
 	bool		bit_buf[MAXBITS];
 
-	double mark_phase;
-	double space_phase;
-
 	double		metric;
 
 	int			rxmode;
@@ -120,6 +114,8 @@ private:
 	bool useFSK;
 
 	RTTY_CHANNEL	channel[MAX_CHANNELS];
+// mark and space filters for every channel, tones 2*ch and 2*ch+1
+	fftchannelizer	*channelizer;
 
 	double		rtty_squelch;
 	double		rtty_shift;
@@ -139,7 +135,6 @@ private:
 
 	void clear_syncscope();
 	void update_syncscope();
-	cmplx mixer(double &phase, double f, cmplx in);
 
 	unsigned char bitreverse(unsigned char in, int n);
 	int decode_char(int ch);
@@ -156,7 +151,7 @@ public:
 	void rx_init();
 	void tx_init(SoundBase *sc){}
 	void restart();
-	void reset_filters(int ch);
+	void reset_filters();
 	int rx_process(const double *buf, int len);
 	int tx_process();
 
@@ -37,10 +37,13 @@
 #define VSIGSEARCH 5
 #define VWAITCOUNT 4
 #define NULLFREQ 1e6
+#define VMIXBLOCK 64
 //=====================================================================
 
 struct CHANNEL {
-	double			phaseacc;
+	cmplx			nco;
+	cmplx			ncostep;
+	double			ncofreq;
 	cmplx			prevsymbol;
 	cmplx			quality;
 	unsigned int	shreg;
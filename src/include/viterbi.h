@@ -28,6 +28,9 @@
 #define PATHMEM 128
 
 class viterbi  {
+public:
+	typedef void (*acs_fn)(const int *prev, int *curr, int *hist,
+			const int *sign0, const int *sign1, int a, int b, int nstates);
 private:
 	int _traceback;
 	int _chunksize;
@@ -38,6 +41,15 @@ private:
 	int sequence[PATHMEM];
 	int mettab[2][256];
 	unsigned int ptr;
+// vector add-compare-select, 0 when the code has no butterfly structure;
+// sign masks of the branch metric of state 2j for soft bits 0 and 1
+	acs_fn acs;
+	int *bmsign[2];
+// symbols decoded, and the span of the last traceback, its path is reused
+// from the point where the new path joins it
+	unsigned int count;
+	unsigned int tb_newest;
+	bool tb_valid;
 	int traceback(int *metric);
 public:
 	viterbi(int k, int poly1, int poly2);
@@ -31,6 +31,7 @@
 #include <FL/Fl_Box.H>
 
 #include "gfft.h"
+#include "spectrum.h"
 #include "fldigi-config.h"
 #include "digiscope.h"
 #include "flslider2.h"
@@ -58,9 +59,14 @@ struct RGBI {
 };
 
 // you can change the basic fft processing type by a simple change in the
-// following typedef.  change to float if you need to skimp on cpu cycles.
+// following typedef.  change to float if you need to skimp on cpu cycles,
+// or build with -DWF_FFT_FLOAT.
 
+#ifdef WF_FFT_FLOAT
+typedef float wf_fft_type;
+#else
 typedef double wf_fft_type;
+#endif
 typedef std::complex<wf_fft_type> wf_cpx_type;
 
 extern	RGBI	mag2RGBI[256];
@@ -147,7 +153,7 @@ public:
 	inline void  makeNotch_(int notch_frequency);
 	inline void makeMarker_(int width, const RGB* color, int freq, const RGB* clrMin, RGB* clrM, const RGB* clrMax);
 	void makeMarker();
-	void process_analog(wf_fft_type *sig, int len);
+	void process_analog(const double *sig, int len);
 	void processFFT();
 	void sig_data( double *sig, int len, int sr );
 	void rfcarrier(long long f) {
@@ -166,6 +172,7 @@ public:
 	double powerDensityMaximum(int bw_nb, const int (*bw)[2]) const ;
 
 	void setPrefilter(int v);
+	void setLatencyWindow(int latency);
 	void setcolors();
 	double dFreq() {return dfreq;}
 	void redrawCursor();
@@ -207,6 +214,9 @@ private:
 	RGB		RGBcursor;
 	RGBI		RGBInotch;
     double  *fftwindow;
+// fftwindow resampled and scaled for the latency wfwindow_latency
+	double	*wfwindow;
+	int		wfwindow_latency;
 	uchar	*scaleimage;
 	uchar	*fft_sig_img;
 	uchar	*sig_img;
@@ -214,11 +224,23 @@ private:
 
 	wf_cpx_type *wfbuf;
 
+// fft_db and fft_img are rings of image_height rows, the newest row is
+// at ptrFFTbuff + 1 and the older rows follow it
 	short int	*fft_db;
 	int			ptrFFTbuff;
+// fft_db rows that are not yet in fft_img, and the mapping of fft_img
+	int			img_newrows;
+	bool		img_remap;
+	int			img_offset;
+	int			img_step;
+	int			img_width;
+	bool		img_averaging;
+// ring of the last FFT_LEN samples, ptrCB is the oldest sample
 	double		*circbuff;
 	int			ptrCB;
 	wf_fft_type	*pwr;
+// pwr as published for the modems, which may read it from any thread
+	spectrum	*spec;
 	g_fft<wf_fft_type> *wfft;
 	int     prefilter;
 
@@ -231,6 +253,8 @@ private:
 	void drawMarker();
 
 	int	 log2disp(int v);
+	int  newest_row() { return (ptrFFTbuff + 1) % image_height; }
+	void map_row(int row);
 	void drawcolorWF();
 	void drawgrayWF();
 	void drawspectrum();
@@ -245,10 +269,8 @@ public:
 	int	newcarrier;
 	int	oldcarrier;
 	bool	tmp_carrier;
-	double Pwr(int i) {
-		if ( i > 0 && i < IMAGE_WIDTH) return pwr[i];
-		return 0.0;
-	}
+	double Pwr(int i) { return spec->power(i); }
+	spectrum *powerSpectrum() { return spec; }
 };
 
 class waterfall: public Fl_Group {
@@ -334,6 +356,8 @@ public:
 			qsy->deactivate();
 	}
 	double Pwr(int i) { return wfdisp->Pwr(i); }
+// the published spectra, for several queries on the same frame
+	spectrum *powerSpectrum() { return wfdisp->powerSpectrum(); }
 
 	int handle(int event);
 
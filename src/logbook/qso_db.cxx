@@ -313,6 +313,7 @@ cQsoDb::cQsoDb() {
   qsorec = new cQsoRec[maxrecs];
   compby = COMPDATE;
   dirty = 0;
+  indexed = false;
 }
 
 cQsoDb::cQsoDb(cQsoDb *db) {
@@ -324,6 +325,7 @@ cQsoDb::cQsoDb(cQsoDb *db) {
   compby = COMPDATE;
   nbrrecs = maxrecs;
   dirty = 0;
+  indexed = false;
 }
 
 cQsoDb::~cQsoDb() {
@@ -336,6 +338,7 @@ void cQsoDb::deleteRecs() {
   maxrecs = MAXRECS;
   qsorec = new cQsoRec[maxrecs];
   dirty = 0;
+  indexed = false;
 }
 
 void cQsoDb::clearDatabase() {
@@ -362,6 +365,7 @@ void cQsoDb::qsoNewRec (cQsoRec *nurec) {
   qsorec[nbrrecs].checkBand();
   qsorec[nbrrecs].checkDateTimes();
   nbrrecs++;
+  indexed = false;
 }
 
 cQsoRec* cQsoDb::newrec() {
@@ -374,6 +378,7 @@ cQsoRec* cQsoDb::newrec() {
     qsorec = atemp;
   }
   nbrrecs++;
+  indexed = false;
   return &qsorec[nbrrecs - 1];
 }
 
@@ -384,6 +389,7 @@ void cQsoDb::qsoDelRec (int rnbr) {
     qsorec[i] = qsorec[i+1];
   nbrrecs--;
   qsorec[nbrrecs].clearRec();
+  indexed = false;
 }
   
 void cQsoDb::qsoUpdRec (int rnbr, cQsoRec *updrec) {
@@ -391,6 +397,7 @@ void cQsoDb::qsoUpdRec (int rnbr, cQsoRec *updrec) {
     return;
   qsorec[rnbr] = *updrec;
   qsorec[rnbr].checkBand();
+  indexed = false;
   return;
 }
 
@@ -398,21 +405,25 @@ void cQsoDb::SortByDate (bool how) {
   date_off = how;
   compby = COMPDATE;
   qsort (qsorec, nbrrecs, sizeof (cQsoRec), compareqsos);
+  indexed = false;
 }
 
 void cQsoDb::SortByCall () {
   compby = COMPCALL;
   qsort (qsorec, nbrrecs, sizeof (cQsoRec), compareqsos);
+  indexed = false;
 }
 
 void cQsoDb::SortByMode () {
   compby = COMPMODE;
   qsort (qsorec, nbrrecs, sizeof (cQsoRec), compareqsos);
+  indexed = false;
 }
 
 void cQsoDb::SortByFreq () {
 	compby = COMPFREQ;
 	qsort (qsorec, nbrrecs, sizeof (cQsoRec), compareqsos);
+	indexed = false;
 }
 
 bool cQsoDb::qsoIsValidFile(const char *fname) {
@@ -513,6 +524,26 @@ unsigned long cQsoDb::epoch_dt (const char *szdate, const char *sztime)
   return doe*60*60*24 + secs;
 }
 
+void cQsoDb::make_index()
+{
+	string call;
+
+	callidx.clear();
+	recfreq.resize(nbrrecs);
+	recdatetime.resize(nbrrecs);
+	for (int i = 0; i < nbrrecs; i++) {
+		call = qsorec[i].getField(CALL);
+		for (size_t n = 0; n < call.length(); n++)
+			call[n] = tolower((unsigned char)call[n]);
+		callidx[call].push_back(i);
+		recfreq[i] = (int)atof(qsorec[i].getField(FREQ));
+		recdatetime[i] = epoch_dt (
+					qsorec[i].getField(QSO_DATE),
+					qsorec[i].getField(TIME_OFF));
+	}
+	indexed = true;
+}
+
 bool cQsoDb::duplicate(
 		const char *callsign, 
 		const char *szdate, const char *sztime, unsigned int interval, bool chkdatetime,
@@ -528,40 +559,47 @@ bool cQsoDb::duplicate(
 		 b_dtimeDUP = true;
 	unsigned long datetime = epoch_dt(szdate, sztime);
 	unsigned long qsodatetime;
-	
-	for (int i = 0; i < nbrrecs; i++) {
-		if (strcasecmp(qsorec[i].getField(CALL), callsign) == 0) {
+
+	if (!indexed)
+		make_index();
+	string call = callsign;
+	for (size_t n = 0; n < call.length(); n++)
+		call[n] = tolower((unsigned char)call[n]);
+	tr1::unordered_map<string, vector<int> >::const_iterator found = callidx.find(call);
+	if (found == callidx.end())
+		return false;
+	const vector<int>& recs = found->second;
+
+	for (size_t j = 0; j < recs.size(); j++) {
+		int i = recs[j];
 // found callsign duplicate
-			b_freqDUP = b_stateDUP = b_modeDUP = 
-				   	   b_xchg1DUP = b_dtimeDUP = false;
-			if (chkfreq) {
-				f2 = (int)atof(qsorec[i].getField(FREQ));
-				b_freqDUP = (f1 == f2);
-			}
-			if (chkstate)
-				b_stateDUP = (qsorec[i].getField(STATE)[0] == 0 && state[0] == 0) ||
-							 (strcasestr(qsorec[i].getField(STATE), state) != 0);
-			if (chkmode)
-				b_modeDUP  = (qsorec[i].getField(MODE)[0] == 0 && mode[0] == 0) ||
-							 (strcasestr(qsorec[i].getField(MODE), mode) != 0);
-			if (chkxchg1)
-				b_xchg1DUP = (qsorec[i].getField(XCHG1)[0] == 0 && xchg1[0] == 0) ||
-							 (strcasestr(qsorec[i].getField(XCHG1), xchg1) != 0);
-
-			if (chkdatetime) {
-				qsodatetime = epoch_dt (
-								qsorec[i].getField(QSO_DATE),
-								qsorec[i].getField(TIME_OFF));
-				if ((datetime - qsodatetime) < interval*60) b_dtimeDUP = true;
-			}
- 			if ( (!chkfreq     || (chkfreq     && b_freqDUP)) &&
-			     (!chkstate    || (chkstate    && b_stateDUP)) &&
-			     (!chkmode     || (chkmode     && b_modeDUP)) &&
-			     (!chkxchg1    || (chkxchg1    && b_xchg1DUP)) &&
-			     (!chkdatetime || (chkdatetime && b_dtimeDUP))) {
-			     return true;
-			 }
+		b_freqDUP = b_stateDUP = b_modeDUP = 
+			   	   b_xchg1DUP = b_dtimeDUP = false;
+		if (chkfreq) {
+			f2 = recfreq[i];
+			b_freqDUP = (f1 == f2);
+		}
+		if (chkstate)
+			b_stateDUP = (qsorec[i].getField(STATE)[0] == 0 && state[0] == 0) ||
+						 (strcasestr(qsorec[i].getField(STATE), state) != 0);
+		if (chkmode)
+			b_modeDUP  = (qsorec[i].getField(MODE)[0] == 0 && mode[0] == 0) ||
+						 (strcasestr(qsorec[i].getField(MODE), mode) != 0);
+		if (chkxchg1)
+			b_xchg1DUP = (qsorec[i].getField(XCHG1)[0] == 0 && xchg1[0] == 0) ||
+						 (strcasestr(qsorec[i].getField(XCHG1), xchg1) != 0);
+
+		if (chkdatetime) {
+			qsodatetime = recdatetime[i];
+			if ((datetime - qsodatetime) < interval*60) b_dtimeDUP = true;
 		}
+ 		if ( (!chkfreq     || (chkfreq     && b_freqDUP)) &&
+		     (!chkstate    || (chkstate    && b_stateDUP)) &&
+		     (!chkmode     || (chkmode     && b_modeDUP)) &&
+		     (!chkxchg1    || (chkxchg1    && b_xchg1DUP)) &&
+		     (!chkdatetime || (chkdatetime && b_dtimeDUP))) {
+		     return true;
+		 }
 	}
 	return false;
 }
@@ -618,6 +618,13 @@ void exit_process() {
 		pskrep_stop();
 
 	for (int i = 0; i < NUM_QRUNNER_THREADS; i++) {
+		fqueue::stats_t st;
+		cbq[i]->stats(st);
+		if (st.pushed)
+			LOG_VERBOSE("qrunner %d: %lu requests, %lu dropped, max depth %d, "
+				    "latency %.3f ms avg, %.3f ms max", i,
+				    st.pushed, st.dropped, (int)st.max_depth,
+				    st.latency_avg * 1e3, st.latency_max * 1e3);
 		cbq[i]->detach();
 		delete cbq[i];
 	}
@@ -705,7 +712,7 @@ void generate_option_help(void) {
 
 #if BENCHMARK_MODE
 	     << "  --benchmark-modem ID\n"
-	     << "    Specify the modem\n"
+	     << "    Specify the modem, or all to run every modem in turn\n"
 	     << "    Default: " << mode_info[benchmark.modem].sname << "\n\n"
 	     << "  --benchmark-frequency FREQ\n"
 	     << "    Specify the modem frequency\n"
@@ -729,7 +736,8 @@ void generate_option_help(void) {
 		", or a filename containing\n"
 		"    non-digit characters"
 #endif
-		"\n\n"
+		"\n"
+		"    May be given more than once to run each input in turn\n\n"
 
 	     << "  --benchmark-output FILE\n"
 	     << "    Specify the output data file\n"
@@ -740,6 +748,29 @@ void generate_option_help(void) {
 	     << "  --benchmark-src-type TYPE\n"
 	     << "    Specify the sample rate conversion type\n"
 	     << "    Default: " << benchmark.src_type << " (" << src_get_name(benchmark.src_type) << ")\n\n"
+	     << "  --benchmark-snr DB\n"
+	     << "    Add white noise to input files for this signal to noise\n"
+	     << "    ratio in a 3 kHz bandwidth\n"
+	     << "    May be given more than once to run each ratio in turn\n"
+	     << "    Default: no noise is added\n\n"
+	     << "  --benchmark-block-size SAMPLES\n"
+	     << "    Specify the number of samples passed to the modem at a time\n"
+	     << "    Default: " << SCBLOCKSIZE << "\n\n"
+	     << "  --benchmark-json FILE\n"
+	     << "    Write the results of every run to FILE in JSON format\n"
+	     << "    The decoder output of an input file is compared with the\n"
+	     << "    text in the file of the same name with a .txt extension\n"
+	     << "    Default: results are only logged\n\n"
+	     << "  --benchmark-kernel NAME[:INPUT]\n"
+	     << "    Time a decoder component instead of, or before, the modems\n"
+	     << "    NAME is one of:\n"
+	     << "      fft (INPUT is an fft size)\n"
+	     << "      mt63 (INPUT is an 8 kHz MT63-2000L recording)\n"
+	     << "      ssdv (INPUT is a received byte stream)\n"
+	     << "      varicode (INPUT is a text file to send)\n"
+	     << "      viterbi (INPUT is an Eb/N0 in dB)\n"
+	     << "    Without an INPUT, the kernel generates its own\n"
+	     << "    May be given more than once to run each kernel in turn\n\n"
 #endif
 
 	     << "  --cpu-speed-test\n"
@@ -862,6 +893,8 @@ int parse_args(int argc, char **argv, int& idx)
 	       OPT_BENCHMARK_MODEM, OPT_BENCHMARK_AFC, OPT_BENCHMARK_SQL, OPT_BENCHMARK_SQLEVEL,
 	       OPT_BENCHMARK_FREQ, OPT_BENCHMARK_INPUT, OPT_BENCHMARK_OUTPUT,
 	       OPT_BENCHMARK_SRC_RATIO, OPT_BENCHMARK_SRC_TYPE,
+	       OPT_BENCHMARK_SNR, OPT_BENCHMARK_BLOCK_SIZE, OPT_BENCHMARK_JSON,
+	       OPT_BENCHMARK_KERNEL,
 #endif
 
                OPT_FONT, OPT_WFALL_HEIGHT,
@@ -906,6 +939,10 @@ int parse_args(int argc, char **argv, int& idx)
 		{ "benchmark-output", 1, 0, OPT_BENCHMARK_OUTPUT },
 		{ "benchmark-src-ratio", 1, 0, OPT_BENCHMARK_SRC_RATIO },
 		{ "benchmark-src-type", 1, 0, OPT_BENCHMARK_SRC_TYPE },
+		{ "benchmark-snr", 1, 0, OPT_BENCHMARK_SNR },
+		{ "benchmark-block-size", 1, 0, OPT_BENCHMARK_BLOCK_SIZE },
+		{ "benchmark-json", 1, 0, OPT_BENCHMARK_JSON },
+		{ "benchmark-kernel", 1, 0, OPT_BENCHMARK_KERNEL },
 #endif
 
 		{ "font",	   1, 0, OPT_FONT },
@@ -1029,6 +1066,10 @@ int parse_args(int argc, char **argv, int& idx)
 
 #if BENCHMARK_MODE
 		case OPT_BENCHMARK_MODEM:
+			if (!strcmp(optarg, "all")) {
+				benchmark.all_modes = true;
+				break;
+			}
 			benchmark.modem = strtol(optarg, NULL, 10);
 			if (!(benchmark.modem >= 0 && benchmark.modem < NUM_MODES)) {
 				fatal_error(_("Bad modem id"));
@@ -1055,7 +1096,7 @@ int parse_args(int argc, char **argv, int& idx)
 			break;
 
 		case OPT_BENCHMARK_INPUT:
-			benchmark.input = optarg;
+			benchmark.inputs.push_back(optarg);
 			break;
 
 		case OPT_BENCHMARK_OUTPUT:
@@ -1069,6 +1110,25 @@ int parse_args(int argc, char **argv, int& idx)
 		case OPT_BENCHMARK_SRC_TYPE:
 			benchmark.src_type = strtol(optarg, NULL, 10);
 			break;
+
+		case OPT_BENCHMARK_SNR:
+			benchmark.snr.push_back(strtod(optarg, NULL));
+			break;
+
+		case OPT_BENCHMARK_BLOCK_SIZE:
+			if (strtol(optarg, NULL, 10) <= 0) {
+				fatal_error(_("Bad block size"));
+			}
+			benchmark.blocksize = strtol(optarg, NULL, 10);
+			break;
+
+		case OPT_BENCHMARK_JSON:
+			benchmark.json = optarg;
+			break;
+
+		case OPT_BENCHMARK_KERNEL:
+			benchmark.kernels.push_back(optarg);
+			break;
 #endif
 
 		case OPT_FONT:
@@ -336,13 +336,27 @@ const char *varienc(int c)
 	return varicode[0];
 }
 
-int varidec(unsigned int symbol)
+/*
+ * And indexed by the code, filled in from varidecode at startup.
+ */
+#define VARIDEC_CODES 4096
+
+static short varidecode_index[VARIDEC_CODES];
+
+static bool varidecode_index_init(void)
 {
-	int i;
+	for (int i = 0; i < VARIDEC_CODES; i++)
+		varidecode_index[i] = -1;
+	for (int i = 255; i >= 0; i--)
+		varidecode_index[varidecode[i]] = i;
+	return true;
+}
+static bool varidecode_index_ok = varidecode_index_init();
 
-	for (i = 0; i < 256; i++)
-		if (symbol == varidecode[i])
-			return i;
+int varidec(unsigned int symbol)
+{
+	if (symbol < VARIDEC_CODES)
+		return varidecode_index[symbol];
 
 	return -1;
 }
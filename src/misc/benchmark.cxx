@@ -24,9 +24,13 @@
 
 #include <fstream>
 #include <string>
+#include <vector>
+#include <algorithm>
+#include <iterator>
 #include <cstdio>
 #include <cstring>
 #include <cstdlib>
+#include <cmath>
 
 #include <inttypes.h>
 #include <sys/time.h>
@@ -45,10 +49,12 @@
 #include "fl_digi.h"
 #include "modem.h"
 #include "trx.h"
+#include "sound.h"
 #include "timeops.h"
 #include "configuration.h"
 #include "status.h"
 #include "debug.h"
+#include "threads.h"
 
 #include "benchmark.h"
 
@@ -56,30 +62,147 @@ using namespace std;
 
 struct benchmark_params benchmark = { MODE_PSK31, 1000, false, false, 0.0, 1.0, SRC_SINC_FASTEST };
 
+// the run requested of the trx thread, and its results; run_pending is
+// set by setup_benchmark and cleared by the trx thread when it is done
+static pthread_mutex_t run_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t run_cond = PTHREAD_COND_INITIALIZER;
+static bool run_pending = false;
+static bool run_noise = false;
+static double run_snr = 0.0;
+
+static struct {
+	size_t nproc, nrx;
+	double wall_time, cpu_time;
+	double rx_time; // in rx_process
+	vector<double> latency; // per rx_process call, microseconds
+} result;
+
+static bool parse_input(const string& input, size_t& samples)
+{
+	char* p;
+	samples = (size_t)strtol(input.c_str(), &p, 10);
+	if (*p != '\0') { // invalid char in input string
+#if USE_SNDFILE
+		// treat as filename
+		samples = 0;
+#else
+		LOG_ERROR("Bad input string, \"%s\"", input.c_str());
+		return false;
+#endif
+	}
+	return true;
+}
+
+// the reference text for an input file is in a file of the same name
+// with a .txt extension
+
+bool read_reference(const string& input, string& text)
+{
+	string::size_type dot = input.rfind('.');
+	string::size_type slash = input.find_last_of("/\\");
+	string fname = input;
+	if (dot != string::npos && (slash == string::npos || dot > slash))
+		fname.erase(dot);
+	fname += ".txt";
+
+	ifstream in(fname.c_str(), ios::in | ios::binary);
+	if (!in)
+		return false;
+	text.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+	return true;
+}
+
+size_t edit_distance(const string& a, const string& b)
+{
+	vector<size_t> d(b.length() + 1);
+	for (size_t j = 0; j <= b.length(); j++)
+		d[j] = j;
+	for (size_t i = 1; i <= a.length(); i++) {
+		size_t prev = d[0];
+		d[0] = i;
+		for (size_t j = 1; j <= b.length(); j++) {
+			size_t cur = d[j];
+			d[j] = min(min(d[j] + 1, d[j - 1] + 1), prev + (a[i - 1] != b[j - 1]));
+			prev = cur;
+		}
+	}
+	return d[b.length()];
+}
+
+static double percentile(vector<double>& v, double p)
+{
+	if (v.empty())
+		return 0.0;
+	vector<double>::iterator i = v.begin() + (size_t)(p * (v.size() - 1) + 0.5);
+	nth_element(v.begin(), i, v.end());
+	return *i;
+}
+
+void json_string(FILE* f, const string& s)
+{
+	fputc('"', f);
+	for (string::const_iterator i = s.begin(); i != s.end(); ++i) {
+		if (*i == '"' || *i == '\\')
+			fprintf(f, "\\%c", *i);
+		else if ((unsigned char)*i < 0x20)
+			fprintf(f, "\\u%04x", (unsigned char)*i);
+		else
+			fputc(*i, f);
+	}
+	fputc('"', f);
+}
+
+static void json_result(FILE* f, trx_mode mode, bool first)
+{
+	double speed = result.rx_time > 0 ? result.nproc / result.rx_time : 0.0;
+	int samplerate = active_modem->get_samplerate();
+
+	fprintf(f, "%s  {\n", first ? "" : ",\n");
+	fprintf(f, "    \"modem\": ");
+	json_string(f, mode_info[mode].sname);
+	fprintf(f, ",\n    \"mode\": %d,\n    \"input\": ", (int)mode);
+	json_string(f, benchmark.input);
+	if (run_noise)
+		fprintf(f, ",\n    \"snr\": %.1f", run_snr);
+	else
+		fprintf(f, ",\n    \"snr\": null");
+	fprintf(f, ",\n    \"samplerate\": %d", samplerate);
+	fprintf(f, ",\n    \"samples\": %" PRIuSZ, result.nproc);
+	fprintf(f, ",\n    \"wall_time\": %.6f", result.wall_time);
+	fprintf(f, ",\n    \"cpu_time\": %.6f", result.cpu_time);
+	fprintf(f, ",\n    \"samples_per_sec\": %.1f", speed);
+	fprintf(f, ",\n    \"realtime_factor\": %.3f", speed / samplerate);
+	fprintf(f, ",\n    \"block_size\": %" PRIuSZ, benchmark.blocksize);
+	fprintf(f, ",\n    \"block_p50_us\": %.3f", percentile(result.latency, 0.50));
+	fprintf(f, ",\n    \"block_p99_us\": %.3f", percentile(result.latency, 0.99));
+	fprintf(f, ",\n    \"decoded_chars\": %" PRIuSZ, benchmark.buffer.length());
+
+	string reference;
+	if (!benchmark.samples && read_reference(benchmark.input, reference) && !reference.empty()) {
+		double accuracy = 1.0 - (double)edit_distance(benchmark.buffer, reference) / reference.length();
+		fprintf(f, ",\n    \"reference_chars\": %" PRIuSZ, reference.length());
+		fprintf(f, ",\n    \"accuracy\": %.4f", accuracy < 0.0 ? 0.0 : accuracy);
+	}
+	else
+		fprintf(f, ",\n    \"accuracy\": null");
+	fprintf(f, "\n  }");
+}
 
 int setup_benchmark(void)
 {
 	ENSURE_THREAD(FLMAIN_TID);
 
-	if (benchmark.input.empty()) {
+	if (benchmark.inputs.empty() && benchmark.kernels.empty()) {
 		LOG_ERROR("Missing input");
 		return 1;
 	}
-	else {
-		char* p;
-		benchmark.samples = (size_t)strtol(benchmark.input.c_str(), &p, 10);
-		if (*p != '\0') { // invalid char in input string
-#if USE_SNDFILE
-			// treat as filename
-			benchmark.samples = 0;
-#else
-			LOG_ERROR("Bad input string, \"%s\"", benchmark.input.c_str());
+	for (size_t i = 0; i < benchmark.inputs.size(); i++)
+		if (!parse_input(benchmark.inputs[i], benchmark.samples))
 			return 1;
-#endif
-		}
-	}
-	if (!benchmark.output.empty())
+	if (!benchmark.output.empty() || !benchmark.json.empty())
 		benchmark.buffer.reserve(BUFSIZ);
+	if (!benchmark.blocksize)
+		benchmark.blocksize = SCBLOCKSIZE;
 
 	progdefaults.rsid = false;
 	progdefaults.StartAtSweetSpot = false;
@@ -92,12 +215,93 @@ int setup_benchmark(void)
 	progStatus.sqlonoff = benchmark.sql;
 	progStatus.sldrSquelchValue = benchmark.sqlevel;
 
+	vector<trx_mode> modes;
+	if (benchmark.all_modes)
+		for (trx_mode m = 0; m < NUM_MODES; m++)
+			modes.push_back(m);
+	else
+		modes.push_back(progStatus.lastmode);
+
+	vector<double> snr = benchmark.snr;
+	run_noise = !snr.empty();
+	if (!run_noise)
+		snr.push_back(0.0);
+
+	ofstream out;
+	if (!benchmark.output.empty())
+		out.open(benchmark.output.c_str());
+
+	FILE* json = 0;
+	if (!benchmark.json.empty()) {
+		if ((json = fopen(benchmark.json.c_str(), "w")) == NULL) {
+			LOG_ERROR("Could not open json file \"%s\"", benchmark.json.c_str());
+			return 1;
+		}
+		fprintf(json, "{\n");
+	}
+
 	debug::level = debug::INFO_LEVEL;
-	TRX_WAIT(STATE_ENDED, trx_start(); init_modem(progStatus.lastmode));
-	if (!benchmark.output.empty()) {
-		ofstream out(benchmark.output.c_str());
-		if (out)
-			out << benchmark.buffer;
+
+	if (!benchmark.kernels.empty()) {
+		if (json)
+			fprintf(json, "\"kernels\": [\n");
+		if (!run_kernel_benchmarks(json)) {
+			if (json)
+				fclose(json);
+			return 1;
+		}
+		if (json)
+			fprintf(json, "\n],\n");
+	}
+
+	if (json)
+		fprintf(json, "\"runs\": [\n");
+	trx_start();
+
+	bool first = true;
+	for (size_t m = 0; m < modes.size(); m++) {
+		for (size_t i = 0; i < benchmark.inputs.size(); i++) {
+			for (size_t n = 0; n < snr.size(); n++) {
+				benchmark.input = benchmark.inputs[i];
+				parse_input(benchmark.input, benchmark.samples);
+				benchmark.buffer.clear();
+				run_snr = snr[n];
+
+				TRX_WAIT(STATE_RX, init_modem(modes[m]));
+				pthread_mutex_lock(&run_mutex);
+				run_pending = true;
+				while (run_pending)
+					pthread_cond_wait(&run_cond, &run_mutex);
+				pthread_mutex_unlock(&run_mutex);
+
+				if (out)
+					out << benchmark.buffer;
+				if (json) {
+					json_result(json, modes[m], first);
+					first = false;
+				}
+			}
+		}
+	}
+
+	trx_close();
+
+	// ru_maxrss is the peak of the whole process, not of a single run
+	long maxrss = -1;
+#ifndef __MINGW32__
+	struct rusage ru;
+	if (getrusage(RUSAGE_SELF, &ru) == 0)
+		maxrss = ru.ru_maxrss;
+	LOG_INFO("peak rss : %ld kB", maxrss);
+#endif
+
+	if (json) {
+		fprintf(json, "\n],\n");
+		if (maxrss >= 0)
+			fprintf(json, "\"peak_rss_kb\": %ld\n}\n", maxrss);
+		else
+			fprintf(json, "\"peak_rss_kb\": null\n}\n");
+		fclose(json);
 	}
 
 	return 0;
@@ -110,10 +314,26 @@ SNDFILE* infile = 0;
 static size_t do_rx(struct rusage ru[2], struct timespec wall_time[2]);
 static size_t do_rx_src(struct rusage ru[2], struct timespec wall_time[2]);
 
-void do_benchmark(void)
+static void run_done(void)
+{
+	guard_lock lock(&run_mutex);
+	run_pending = false;
+	pthread_cond_signal(&run_cond);
+}
+
+// Runs the benchmark requested by setup_benchmark, returns false when
+// there is none
+
+bool do_benchmark(void)
 {
 	ENSURE_THREAD(TRX_TID);
 
+	{
+		guard_lock lock(&run_mutex);
+		if (!run_pending)
+			return false;
+	}
+
 	if (benchmark.src_ratio != 1.0)
 		LOG_INFO("modem=%" PRIdPTR " (%s) rate=%d ratio=%f converter=%d (\"%s\")",
 			 active_modem->get_mode(), mode_info[active_modem->get_mode()].sname,
@@ -122,13 +342,20 @@ void do_benchmark(void)
 	else
 		LOG_INFO("modem=%" PRIdPTR " (%s) rate=%d", active_modem->get_mode(),
 			 mode_info[active_modem->get_mode()].sname, active_modem->get_samplerate());
+	if (run_noise)
+		LOG_INFO("input=\"%s\" snr=%.1f dB", benchmark.input.c_str(), run_snr);
+
+	result.nproc = result.nrx = 0;
+	result.wall_time = result.cpu_time = result.rx_time = 0.0;
+	result.latency.clear();
 
 #if USE_SNDFILE
 	if (!benchmark.samples) {
 		SF_INFO info = { 0, 0, 0, 0, 0, 0 };
 		if ((infile = sf_open(benchmark.input.c_str(), SFM_READ, &info)) == NULL) {
 			LOG_ERROR("Could not open input file \"%s\"", benchmark.input.c_str());
-			return;
+			run_done();
+			return true;
 		}
 	}
 #endif
@@ -158,16 +385,92 @@ void do_benchmark(void)
 	LOG_INFO("cpu time : %" PRIdMAX ".%03" PRIdMAX "; speed=%.3f samples/s; factor=%.3f",
 		 (intmax_t)ru[1].ru_utime.tv_sec, (intmax_t)ru[1].ru_utime.tv_usec / 1000,
 		 speed, speed / active_modem->get_samplerate());
+
+	result.nproc = nproc;
+	result.nrx = nrx;
+	result.wall_time = wall_time[1].tv_sec + wall_time[1].tv_nsec / 1e9;
+	result.cpu_time = ru[1].ru_utime.tv_sec + ru[1].ru_utime.tv_usec / 1e6;
+
+	run_done();
+	return true;
 }
 
 // ----------------------------------------------------------------------------
 
+// White gaussian noise for the snr runs, with its own generator so that
+// every run of an input sees the same noise
+
+static unsigned int noise_seed;
+static double noise_sigma;
+
+static inline double noise_uniform(void)
+{
+	noise_seed = noise_seed * 1664525U + 1013904223U;
+	return (noise_seed >> 8) / 16777216.0;
+}
+
+// same method as modem::gauss
+static inline double noise_gauss(double sigma)
+{
+	double r = sigma * sqrt(2.0 * log(1.0 / (1.0 - noise_uniform())));
+	return r * cos(2.0 * M_PI * noise_uniform());
+}
+
+// The snr is the ratio of the input signal power to the noise power in a
+// 3 kHz bandwidth.  Noise is only added to file inputs.
+
+static void setup_noise(void)
+{
+	noise_seed = 1;
+	noise_sigma = 0.0;
+#if USE_SNDFILE
+	if (!run_noise || !infile)
+		return;
+
+	size_t len = 1 << 16, total = 0;
+	double* buf = new double[len];
+	double power = 0.0;
+	for (size_t n; (n = sf_readf_double(infile, buf, len)); total += n)
+		for (size_t i = 0; i < n; i++)
+			power += buf[i] * buf[i];
+	sf_seek(infile, 0, SEEK_SET);
+	delete [] buf;
+
+	if (total) {
+		double bandwidth = active_modem->get_samplerate() / 2.0;
+		power /= total;
+		noise_sigma = sqrt(power / pow(10.0, run_snr / 10.0) * bandwidth / 3000.0);
+	}
+#endif
+}
+
+// one receive block, rx_process is timed for the latency figures
+
+static void rx_block(double* buf, size_t len)
+{
+	if (noise_sigma)
+		for (size_t i = 0; i < len; i++)
+			buf[i] += noise_gauss(noise_sigma);
+
+	struct timespec t[2];
+	clock_gettime(CLOCK_MONOTONIC, &t[0]);
+	active_modem->rx_process(buf, len);
+	clock_gettime(CLOCK_MONOTONIC, &t[1]);
+	t[1] -= t[0];
+
+	double us = t[1].tv_sec * 1e6 + t[1].tv_nsec / 1e3;
+	result.latency.push_back(us);
+	result.rx_time += us / 1e6;
+}
+
 static size_t do_rx(struct rusage ru[2], struct timespec wall_time[2])
 {
 	size_t nread;
-	size_t inlen = 1 << 19;
+	size_t inlen = benchmark.blocksize;
 	double* inbuf = new double[inlen];
 
+	setup_noise();
+
 #if USE_SNDFILE
 	if (infile) {
 		nread = 0;
@@ -175,19 +478,20 @@ static size_t do_rx(struct rusage ru[2], struct timespec wall_time[2])
 		getrusage(RUSAGE_SELF, &ru[0]);
 
 		for (size_t n; (n = sf_readf_double(infile, inbuf, inlen)); nread += n)
-			active_modem->rx_process(inbuf, n);
+			rx_block(inbuf, n);
 	}
 	else
 #endif
 	{
 		memset(inbuf, 0, sizeof(double) * inlen);
+		result.latency.reserve(benchmark.samples / inlen + 1);
 		clock_gettime(CLOCK_MONOTONIC, &wall_time[0]);
 		getrusage(RUSAGE_SELF, &ru[0]);
 
 		for (nread = benchmark.samples; nread > inlen; nread -= inlen)
-			active_modem->rx_process(inbuf, inlen);
+			rx_block(inbuf, inlen);
 		if (nread)
-			active_modem->rx_process(inbuf, nread);
+			rx_block(inbuf, nread);
 		nread = benchmark.samples;
 	}
 
@@ -233,6 +537,7 @@ static size_t do_rx_src(struct rusage ru[2], struct timespec wall_time[2])
 	}
 
 	inbuf = new float[inlen];
+	setup_noise();
 	size_t outlen = (size_t)floor(inlen * benchmark.src_ratio);
 	float* outbuf = new float[outlen];
 	double* rxbuf = new double[outlen];
@@ -248,7 +553,7 @@ static size_t do_rx_src(struct rusage ru[2], struct timespec wall_time[2])
 		while ((n = src_callback_read(src_state, benchmark.src_ratio, outlen, outbuf))) {
 			for (long i = 0; i < n; i++)
 				rxbuf[i] = outbuf[i];
-			active_modem->rx_process(rxbuf, n);
+			rx_block(rxbuf, n);
 			nread += n;
 		}
 
@@ -266,14 +571,14 @@ static size_t do_rx_src(struct rusage ru[2], struct timespec wall_time[2])
 				break;
 			for (long i = 0; i < n; i++)
 				rxbuf[i] = outbuf[i];
-			active_modem->rx_process(rxbuf, n);
+			rx_block(rxbuf, n);
 			nread -= (size_t)n;
 		}
 		if (nread) {
 			if ((n = src_callback_read(src_state, benchmark.src_ratio, nread, outbuf))) {
 				for (long i = 0; i < n; i++)
 					rxbuf[i] = outbuf[i];
-				active_modem->rx_process(rxbuf, n);
+				rx_block(rxbuf, n);
 			}
 		}
 		nread = benchmark.samples;
@@ -0,0 +1,893 @@
+// ----------------------------------------------------------------------------
+//      benchmark_kernels.cxx
+//
+// Micro benchmarks of single decoder components, see --benchmark-kernel
+//
+// This file is part of fldigi.
+//
+// fldigi is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// fldigi is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+// ----------------------------------------------------------------------------
+
+#include <config.h>
+
+#include <fstream>
+#include <string>
+#include <vector>
+#include <iterator>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <cmath>
+
+#include <stdint.h>
+#include <sys/time.h>
+
+#if USE_SNDFILE
+#  include <sndfile.h>
+#endif
+
+#ifndef __MINGW32__
+#  include <sys/resource.h>
+#else
+#  include "compat.h"
+#endif
+
+extern "C" {
+#include <jpeglib.h>
+}
+
+#include "configuration.h"
+#include "debug.h"
+#include "ssdv_rx.h"
+#include "gfft.h"
+#include "simd.h"
+#include "dsp.h"
+#include "mt63base.h"
+#include "pskvaricode.h"
+#include "mfskvaricode.h"
+#include "thorvaricode.h"
+#include "viterbi.h"
+
+#include "benchmark.h"
+
+using namespace std;
+
+// ----------------------------------------------------------------------------
+// Results are logged, and written to the "kernels" array of the json file
+// as one record per case
+
+static FILE* json;
+static bool json_first;
+static string record_log;
+
+static void record_begin(const char* kernel, const string& name)
+{
+	record_log = string(kernel) + " " + name + ":";
+	if (!json)
+		return;
+	fprintf(json, "%s  {\n    \"kernel\": ", json_first ? "" : ",\n");
+	json_string(json, kernel);
+	fprintf(json, ",\n    \"case\": ");
+	json_string(json, name);
+	json_first = false;
+}
+
+static void record_value(const char* key, double value)
+{
+	char buf[64];
+	snprintf(buf, sizeof(buf), " %s=%.6g", key, value);
+	record_log += buf;
+	if (json)
+		fprintf(json, ",\n    \"%s\": %.6g", key, value);
+}
+
+static void record_end(void)
+{
+	LOG_INFO("%s", record_log.c_str());
+	if (json)
+		fprintf(json, "\n  }");
+}
+
+// cpu time of the whole process, user and system, in seconds
+static double cpu_time(void)
+{
+	struct rusage ru;
+	getrusage(RUSAGE_SELF, &ru);
+	return ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1e6 +
+	       ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1e6;
+}
+
+// same generator as the benchmark noise, so that every run is the same
+static unsigned int random_seed;
+
+static inline unsigned int random_next(void)
+{
+	random_seed = random_seed * 1664525U + 1013904223U;
+	return random_seed >> 8;
+}
+
+// same method as modem::gauss
+static double random_gauss(double sigma)
+{
+	double u1 = random_next() / 16777216.0, u2 = random_next() / 16777216.0;
+	double r = sigma * sqrt(2.0 * log(1.0 / (1.0 - u1)));
+	return r * cos(2.0 * M_PI * u2);
+}
+
+static bool read_file(const string& fname, vector<uint8_t>& data)
+{
+	ifstream in(fname.c_str(), ios::in | ios::binary);
+	if (!in) {
+		LOG_ERROR("Could not open input file \"%s\"", fname.c_str());
+		return false;
+	}
+	data.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+	return true;
+}
+
+// ----------------------------------------------------------------------------
+// SSDV: a received byte stream is replayed through ssdv_rx.  The input is a
+// file of the bytes passed to put_rx_ssdv by the modem.  Without one, a
+// stream of random bytes and a stream of test card packets with byte errors
+// and noise between them are generated.  The decoder cpu time is given per
+// second of input at the byte rate of 600 baud RTTY with 8 data bits and 2
+// stop bits.
+
+#define SSDV_BYTE_RATE (600.0 / 11.0)
+#define SSDV_STREAM_LEN (256 * 1024)
+
+// JPEG destination appending to a vector
+struct jpeg_vector_dest {
+	struct jpeg_destination_mgr pub;
+	vector<uint8_t>* out;
+	JOCTET buf[4096];
+};
+
+static void jpeg_vector_init(j_compress_ptr cinfo)
+{
+	jpeg_vector_dest* dest = (jpeg_vector_dest*)cinfo->dest;
+	dest->pub.next_output_byte = dest->buf;
+	dest->pub.free_in_buffer = sizeof(dest->buf);
+}
+
+static boolean jpeg_vector_empty(j_compress_ptr cinfo)
+{
+	jpeg_vector_dest* dest = (jpeg_vector_dest*)cinfo->dest;
+	dest->out->insert(dest->out->end(), dest->buf, dest->buf + sizeof(dest->buf));
+	dest->pub.next_output_byte = dest->buf;
+	dest->pub.free_in_buffer = sizeof(dest->buf);
+	return TRUE;
+}
+
+static void jpeg_vector_term(j_compress_ptr cinfo)
+{
+	jpeg_vector_dest* dest = (jpeg_vector_dest*)cinfo->dest;
+	dest->out->insert(dest->out->end(), dest->buf,
+			  dest->buf + sizeof(dest->buf) - dest->pub.free_in_buffer);
+}
+
+static void ssdv_test_jpeg(vector<uint8_t>& jpeg, int width, int height)
+{
+	struct jpeg_compress_struct cinfo;
+	struct jpeg_error_mgr jerr;
+	jpeg_vector_dest dest;
+
+	cinfo.err = jpeg_std_error(&jerr);
+	jpeg_create_compress(&cinfo);
+	dest.pub.init_destination = jpeg_vector_init;
+	dest.pub.empty_output_buffer = jpeg_vector_empty;
+	dest.pub.term_destination = jpeg_vector_term;
+	dest.out = &jpeg;
+	cinfo.dest = &dest.pub;
+
+	cinfo.image_width = width;
+	cinfo.image_height = height;
+	cinfo.input_components = 3;
+	cinfo.in_color_space = JCS_RGB;
+	jpeg_set_defaults(&cinfo);
+	jpeg_set_quality(&cinfo, 80, TRUE);
+	jpeg_start_compress(&cinfo, TRUE);
+
+	vector<JSAMPLE> row(width * 3);
+	while (cinfo.next_scanline < cinfo.image_height) {
+		int y = cinfo.next_scanline;
+		for (int x = 0; x < width; x++) {
+			row[3 * x] = (x * 255) / width;
+			row[3 * x + 1] = (y * 255) / height;
+			row[3 * x + 2] = ((x / 16 + y / 16) & 1) ? 224 : 32;
+		}
+		JSAMPROW r = &row[0];
+		jpeg_write_scanlines(&cinfo, &r, 1);
+	}
+
+	jpeg_finish_compress(&cinfo);
+	jpeg_destroy_compress(&cinfo);
+}
+
+static void ssdv_test_packets(vector<uint8_t>& stream, size_t len)
+{
+	vector<uint8_t> jpeg;
+	ssdv_test_jpeg(jpeg, 320, 240);
+
+	char callsign[] = "BENCH";
+	uint8_t pkt[SSDV_PKT_SIZE];
+	for (uint8_t id = 0; stream.size() < len; id++) {
+		ssdv_t enc;
+		ssdv_enc_init(&enc, callsign, id);
+		ssdv_enc_set_buffer(&enc, pkt);
+
+		size_t fed = 0;
+		char r;
+		do {
+			while ((r = ssdv_enc_get_packet(&enc)) == SSDV_FEED_ME && fed < jpeg.size()) {
+				size_t n = min(jpeg.size() - fed, (size_t)256);
+				ssdv_enc_feed(&enc, &jpeg[fed], n);
+				fed += n;
+			}
+			if (r != SSDV_OK && r != SSDV_EOI)
+				break;
+
+			// up to 63 bytes of noise, and 8 byte errors per packet,
+			// half of what the reed-solomon code corrects
+			for (unsigned int n = random_next() % 64; n > 0; n--)
+				stream.push_back(random_next());
+			size_t start = stream.size();
+			stream.insert(stream.end(), pkt, pkt + SSDV_PKT_SIZE);
+			for (int n = 0; n < 8; n++)
+				stream[start + random_next() % SSDV_PKT_SIZE] ^= 1 + random_next() % 255;
+		} while (r != SSDV_EOI && stream.size() < len);
+	}
+}
+
+static void ssdv_replay(const string& name, const vector<uint8_t>& stream)
+{
+	ssdv_rx* rx = new ssdv_rx(320, 240 + 60, "SSDV RX");
+
+	// the receive queue holds 4096 bytes, feed less than that at a time
+	double t = cpu_time();
+	for (size_t i = 0; i < stream.size(); i += 1024) {
+		size_t n = min(stream.size() - i, (size_t)1024);
+		for (size_t j = 0; j < n; j++)
+			rx->put_byte(stream[i + j], 0);
+		rx->wait_idle();
+	}
+	t = cpu_time() - t;
+
+	delete rx;
+
+	double input = stream.size() / SSDV_BYTE_RATE;
+	record_begin("ssdv", name);
+	record_value("bytes", stream.size());
+	record_value("input_time", input);
+	record_value("cpu_time", t);
+	record_value("cpu_per_input_sec", input > 0 ? t / input : 0.0);
+	record_value("bytes_per_sec", t > 0 ? stream.size() / t : 0.0);
+	record_end();
+}
+
+static bool bench_ssdv(const string& input)
+{
+	bool save_image = progdefaults.ssdv_save_image;
+	progdefaults.ssdv_save_image = false;
+
+	vector<uint8_t> stream;
+	if (!input.empty()) {
+		if (!read_file(input, stream))
+			return false;
+		ssdv_replay(input, stream);
+	}
+	else {
+		random_seed = 1;
+		for (size_t i = 0; i < SSDV_STREAM_LEN; i++)
+			stream.push_back(random_next());
+		ssdv_replay("noise", stream);
+
+		stream.clear();
+		ssdv_test_packets(stream, SSDV_STREAM_LEN);
+		ssdv_replay("packets", stream);
+	}
+
+	progdefaults.ssdv_save_image = save_image;
+	return true;
+}
+
+// ----------------------------------------------------------------------------
+// FFT: g_fft transforms of the sizes the waterfall, rsid and the modems use,
+// in double and float, with the scalar stages and each vector width the cpu
+// runs.  The input is an fft size; without one all sizes are timed.  The
+// largest difference from the scalar output is given relative to the
+// largest output value.
+
+#define FFT_MIN_CPU 0.2
+
+template <typename T>
+static void fft_case(const char* type, int size, int width, bool real)
+{
+	g_fft<T> fft(size);
+	g_fft<T> ref(size);
+	fft.set_simd_width(width);
+	ref.set_simd_width(0);
+
+	vector< complex<T> > in(size), a(size), b(size);
+	random_seed = size;
+	for (int i = 0; i < size; i++)
+		in[i] = complex<T>((int)(random_next() % 2001) - 1000,
+				   (int)(random_next() % 2001) - 1000) / T(1000);
+
+	a = in;
+	b = in;
+	if (real) {
+		fft.RealFFT(&a[0]);
+		ref.RealFFT(&b[0]);
+	}
+	else {
+		fft.ComplexFFT(&a[0]);
+		ref.ComplexFFT(&b[0]);
+	}
+	double err = 0.0, top = 0.0;
+	for (int i = 0; i < size; i++) {
+		err = max(err, (double)abs(a[i] - b[i]));
+		top = max(top, (double)abs(b[i]));
+	}
+
+// repeat until the run is long enough to time with getrusage
+	long n = 0;
+	double t = cpu_time(), t0 = t;
+	do {
+		for (int k = 0; k < 64; k++, n++) {
+			a = in;
+			if (real)
+				fft.RealFFT(&a[0]);
+			else
+				fft.ComplexFFT(&a[0]);
+		}
+		t = cpu_time();
+	} while (t - t0 < FFT_MIN_CPU);
+
+	char name[64];
+	snprintf(name, sizeof(name), "%s %s %d %s", type, real ? "real" : "complex",
+		 size, width == 0 ? "scalar" : width == 128 ? "128" : "256");
+	record_begin("fft", name);
+	record_value("size", size);
+	record_value("vector_bits", width);
+	record_value("transforms", n);
+	record_value("cpu_time", t - t0);
+	record_value("usec_per_fft", 1e6 * (t - t0) / n);
+	record_value("max_error", top > 0 ? err / top : 0.0);
+	record_end();
+}
+
+static bool bench_fft(const string& input)
+{
+	vector<int> sizes;
+	if (!input.empty()) {
+		int size = atoi(input.c_str());
+		if (size < 16 || (size & (size - 1))) {
+			LOG_ERROR("FFT size must be a power of 2 of at least 16: \"%s\"",
+				  input.c_str());
+			return false;
+		}
+		sizes.push_back(size);
+	}
+	else
+		for (int size = 512; size <= 16384; size *= 2)
+			sizes.push_back(size);
+
+	vector<int> widths;
+	widths.push_back(0);
+#ifdef SIMD_VECTORS
+	widths.push_back(128);
+#  ifdef SIMD_AVX2
+	if (simd_have_avx2())
+		widths.push_back(256);
+#  endif
+#endif
+
+	for (size_t i = 0; i < sizes.size(); i++)
+		for (size_t w = 0; w < widths.size(); w++)
+			for (int real = 0; real < 2; real++) {
+				fft_case<double>("double", sizes[i], widths[w], real);
+				fft_case<float>("float", sizes[i], widths[w], real);
+			}
+
+	return true;
+}
+
+// ----------------------------------------------------------------------------
+// MT63: text sent with MT63tx in MT63-2000 with the long interleave is
+// decoded by MT63rx with the double and with the float dsp kernels, see
+// dsp.h.  White noise is added for each --benchmark-snr, or for a range
+// of snrs down to where the decoder fails, in a 3 kHz bandwidth as for the
+// modem runs.  The character error rate is the edit distance to the text
+// sent over its length.  The input is an 8 kHz recording of MT63-2000L at
+// 1500 Hz instead, with the text sent in a .txt file as for the modem runs.
+// The run fails if the float kernels make more errors than the double ones
+// on more than 1% of the text.
+
+#define MT63_RATE 8000
+#define MT63_FREQ 1500.0
+#define MT63_BW 2000
+#define MT63_BLOCK 512
+#define MT63_REPEAT 4
+
+static const char mt63_text[] =
+	"CQ CQ CQ DE BENCH BENCH BENCH PSE K\n"
+	"THE QUICK BROWN FOX JUMPS OVER THE LAZY DOG 0123456789\n"
+	"the quick brown fox jumps over the lazy dog, again and again.\n"
+	"MT63 spreads each character over 64 carriers and a long interleave,\n"
+	"so that it is still read when the noise is louder than the signal.\n"
+	"RST 599 599 QTH LONDON LONDON NAME BEN BEN HW CPY? BENCH DE TEST K\n"
+	"=== ### *** +++ --- ::: ;;; ,,, ... /// ??? !!! @@@ $$$ %%% &&& (((\n"
+	"73 and good DX, this is the end of the MT63 benchmark text. SK\n";
+
+static void mt63_modulate(vector<double>& sig, const string& ref)
+{
+	MT63tx tx;
+	tx.Preset(MT63_FREQ, MT63_BW, 1);
+
+// idle symbols for the receiver to lock and fill its interleaver, and
+// enough after the text to flush both interleavers
+	string idle(2 * tx.DataInterleave + 20, '\0');
+	string text = idle + ref + idle;
+	sig.clear();
+	for (size_t i = 0; i < text.length(); i++) {
+		tx.SendChar(text[i]);
+		sig.insert(sig.end(), tx.Comb.Output.Data,
+			   tx.Comb.Output.Data + tx.Comb.Output.Len);
+	}
+	double peak = 0.0;
+	for (size_t i = 0; i < sig.size(); i++)
+		peak = max(peak, fabs(sig[i]));
+	for (size_t i = 0; i < sig.size(); i++)
+		sig[i] *= 0.9 / peak;
+}
+
+static void mt63_add_noise(const vector<double>& sig, vector<double>& out, double snr)
+{
+	double power = 0.0;
+	for (size_t i = 0; i < sig.size(); i++)
+		power += sig[i] * sig[i];
+	power /= sig.size();
+	double sigma = sqrt(power / pow(10.0, snr / 10.0) * (MT63_RATE / 2.0) / 3000.0);
+
+	random_seed = 1;
+	out.resize(sig.size());
+	for (size_t i = 0; i < sig.size(); i++)
+		out[i] = sig[i] + random_gauss(sigma);
+}
+
+// decodes sig and returns the cpu time it took
+static double mt63_demodulate(const vector<double>& sig, string& text)
+{
+	MT63rx rx;
+	double_buff buf;
+	rx.Preset(MT63_FREQ, MT63_BW, 1, 16);
+
+	text.clear();
+	double t = cpu_time();
+	for (size_t i = 0; i < sig.size(); i += MT63_BLOCK) {
+		int n = min(sig.size() - i, (size_t)MT63_BLOCK);
+		buf.EnsureSpace(n);
+		copy(sig.begin() + i, sig.begin() + i + n, buf.Data);
+		buf.Len = n;
+		rx.Process(&buf);
+		for (int k = 0; k < rx.Output.Len; k++) {
+			char c = rx.Output.Data[k];
+			if ((c >= ' ' && c < 127) || c == '\n')
+				text += c;
+		}
+	}
+	return cpu_time() - t;
+}
+
+#ifdef MT63_HAVE_FLOAT_SIMD
+// The edit distance from the reference to the decoded text, where the
+// characters decoded before the reference starts are free: the receiver
+// prints noise while it locks and fills its interleaver.
+static size_t mt63_errors(const string& text, const string& ref)
+{
+	vector<size_t> d(text.length() + 1, 0);
+	for (size_t i = 1; i <= ref.length(); i++) {
+		size_t prev = d[0];
+		d[0] = i;
+		for (size_t j = 1; j <= text.length(); j++) {
+			size_t cur = d[j];
+			d[j] = min(min(d[j] + 1, d[j - 1] + 1), prev + (ref[i - 1] != text[j - 1]));
+			prev = cur;
+		}
+	}
+	return d[text.length()];
+}
+
+static string mt63_case(const string& name, double snr)
+{
+	char buf[32];
+	snprintf(buf, sizeof(buf), " snr %g dB", snr);
+	return name + buf;
+}
+
+static bool mt63_compare(const string& name, const vector<double>& sig, const string& ref)
+{
+	bool float_kernels = dspFloatKernels;
+	string out[2];
+	double t[2];
+	size_t err[2];
+	for (int k = 0; k < 2; k++) {
+		dspFloatKernels = k;
+		t[k] = mt63_demodulate(sig, out[k]);
+		err[k] = mt63_errors(out[k], ref);
+	}
+	dspFloatKernels = float_kernels;
+
+	double chars = ref.length();
+	record_begin("mt63", name);
+	record_value("chars", chars);
+	record_value("double_errors", err[0]);
+	record_value("float_errors", err[1]);
+	record_value("double_cer", err[0] / chars);
+	record_value("float_cer", err[1] / chars);
+	record_value("output_diff", edit_distance(out[0], out[1]));
+	record_value("double_cpu", t[0]);
+	record_value("float_cpu", t[1]);
+	record_value("input_time", (double)sig.size() / MT63_RATE);
+	record_end();
+
+	if (err[1] > err[0] + chars / 100) {
+		LOG_ERROR("MT63 float kernels: %d errors, double kernels: %d",
+			  (int)err[1], (int)err[0]);
+		return false;
+	}
+	return true;
+}
+#endif
+
+static bool bench_mt63(const string& input)
+{
+#ifndef MT63_HAVE_FLOAT_SIMD
+	LOG_INFO("MT63 float kernels are not built for this target");
+	return true;
+#else
+	vector<double> sig, noisy;
+	string ref;
+	bool ok = true;
+
+	if (!input.empty()) {
+#  if USE_SNDFILE
+		SF_INFO info;
+		memset(&info, 0, sizeof(info));
+		SNDFILE* f = sf_open(input.c_str(), SFM_READ, &info);
+		if (!f) {
+			LOG_ERROR("Could not open input file \"%s\"", input.c_str());
+			return false;
+		}
+		if (info.samplerate != MT63_RATE || info.channels != 1) {
+			LOG_ERROR("%s: need 8000 Hz mono, not %d Hz with %d channels",
+				  input.c_str(), info.samplerate, info.channels);
+			sf_close(f);
+			return false;
+		}
+		sig.resize(info.frames);
+		if (!sig.empty())
+			sig.resize(sf_readf_double(f, &sig[0], info.frames));
+		sf_close(f);
+		if (!read_reference(input, ref)) {
+			LOG_ERROR("No reference text for \"%s\"", input.c_str());
+			return false;
+		}
+		ok = mt63_compare(input, sig, ref);
+		for (size_t i = 0; ok && i < benchmark.snr.size(); i++) {
+			mt63_add_noise(sig, noisy, benchmark.snr[i]);
+			ok = mt63_compare(mt63_case(input, benchmark.snr[i]), noisy, ref);
+		}
+		return ok;
+#  else
+		LOG_ERROR("Audio file input needs libsndfile");
+		return false;
+#  endif
+	}
+
+	for (int i = 0; i < MT63_REPEAT; i++)
+		ref += mt63_text;
+	mt63_modulate(sig, ref);
+	vector<double> snr = benchmark.snr;
+	if (snr.empty())
+		for (double s = 0.0; s >= -12.0; s -= 2.0)
+			snr.push_back(s);
+
+	ok = mt63_compare("MT63-2000L", sig, ref);
+	for (size_t i = 0; ok && i < snr.size(); i++) {
+		mt63_add_noise(sig, noisy, snr[i]);
+		ok = mt63_compare(mt63_case("MT63-2000L", snr[i]), noisy, ref);
+	}
+	return ok;
+#endif
+}
+
+// ----------------------------------------------------------------------------
+// Varicode: characters are encoded and the bits fed to the character decoders
+// of the PSK, MFSK and THOR receivers, as in psk::rx_bit, mfsk::recvbit and
+// thor::softdecode.  The input is a text file to send; without one, random
+// bytes are sent, and for THOR also the secondary characters.  The run
+// fails if a character is not decoded as it was sent.
+
+#define VARICODE_CHARS 65536
+#define VARICODE_MIN_CPU 0.5
+
+enum { VARICODE_PSK, VARICODE_MFSK, VARICODE_THOR };
+
+static const char* varicode_encode(int code, int c)
+{
+	switch (code) {
+	case VARICODE_PSK:
+		return psk_varicode_encode(c);
+	case VARICODE_MFSK:
+		return varienc(c);
+	default:
+		return thorvarienc(c & 0xff, c & 0x100);
+	}
+}
+
+// returns the decoded characters, with -1 for a code that is not found
+static void varicode_decode(int code, const vector<uint8_t>& bits, vector<int>& out)
+{
+// the mfsk and thor shift registers hold the first bit of the character
+// being received, which is always 1
+	unsigned int shreg = code == VARICODE_PSK ? 0 : 1;
+
+	out.clear();
+	for (size_t i = code == VARICODE_PSK ? 0 : 1; i < bits.size(); i++) {
+		shreg = (shreg << 1) | bits[i];
+		if (code == VARICODE_PSK) {
+			if ((shreg & 3) == 0) {
+				if (shreg >> 2)
+					out.push_back(psk_varicode_decode(shreg >> 2));
+				shreg = 0;
+			}
+		}
+		else if ((shreg & 7) == 1) {
+			out.push_back(code == VARICODE_MFSK ? varidec(shreg >> 1) :
+				      thorvaridec(shreg >> 1));
+			shreg = 1;
+		}
+	}
+}
+
+static bool varicode_case(const char* name, int code, const vector<int>& text)
+{
+	vector<uint8_t> bits;
+	for (size_t i = 0; i < text.size(); i++) {
+		for (const char* p = varicode_encode(code, text[i]); *p; p++)
+			bits.push_back(*p - '0');
+		if (code == VARICODE_PSK) {
+			bits.push_back(0);
+			bits.push_back(0);
+		}
+	}
+// the mfsk and thor receivers decode a character when the next one starts
+	if (code != VARICODE_PSK)
+		bits.push_back(1);
+
+	vector<int> out;
+	varicode_decode(code, bits, out);
+	size_t errors = max(out.size(), text.size()) - min(out.size(), text.size());
+	for (size_t i = 0; i < min(out.size(), text.size()); i++)
+		errors += out[i] != text[i];
+
+	long n = 0;
+	double t = cpu_time(), t0 = t;
+	do {
+		varicode_decode(code, bits, out);
+		n += text.size();
+		t = cpu_time();
+	} while (t - t0 < VARICODE_MIN_CPU);
+
+	record_begin("varicode", name);
+	record_value("chars", n);
+	record_value("bits_per_char", (double)bits.size() / text.size());
+	record_value("cpu_time", t - t0);
+	record_value("chars_per_sec", n / (t - t0));
+	record_value("errors", errors);
+	record_end();
+
+	if (errors) {
+		LOG_ERROR("%s varicode: %d of %d characters decoded wrongly",
+			  name, (int)errors, (int)text.size());
+		return false;
+	}
+	return true;
+}
+
+static bool bench_varicode(const string& input)
+{
+	vector<int> text, thor;
+	if (!input.empty()) {
+		vector<uint8_t> data;
+		if (!read_file(input, data))
+			return false;
+		if (data.empty()) {
+			LOG_ERROR("Empty input file \"%s\"", input.c_str());
+			return false;
+		}
+		text.assign(data.begin(), data.end());
+		thor = text;
+	}
+	else {
+		random_seed = 1;
+		for (int i = 0; i < VARICODE_CHARS; i++) {
+			text.push_back(random_next() & 0xff);
+			int c = random_next() % (256 + 'z' - ' ' + 1);
+			thor.push_back(c < 256 ? c : c - 256 + ' ' + 0x100);
+		}
+	}
+
+	return varicode_case("psk", VARICODE_PSK, text) &&
+	       varicode_case("mfsk", VARICODE_MFSK, text) &&
+	       varicode_case("thor", VARICODE_THOR, thor);
+}
+
+// ----------------------------------------------------------------------------
+// Viterbi: decoder throughput for the convolutional codes of the modems, with
+// their traceback and chunk sizes.  Random bits are encoded and sent as soft
+// symbols with white noise; the input is the Eb/N0 in dB, 4 dB without one.
+// The bit errors are counted on the first pass over the symbols, at the
+// decoder delay with the fewest errors.
+
+#define VITERBI_BITS 8192
+#define VITERBI_MIN_CPU 0.5
+
+struct viterbi_code {
+	const char* name;
+	int k, poly1, poly2;
+	int traceback, chunksize;
+};
+
+static const viterbi_code viterbi_codes[] = {
+	{ "K=5 qpsk", 5, 0x17, 0x19, PATHMEM - 1, 8 },
+	{ "K=7 pskr", 7, 0x6d, 0x4f, PATHMEM - 1, 4 },
+	{ "K=7 mfsk thor dominoex", 7, 0x6d, 0x4f, 45, 1 },
+	{ "K=15 thor", 15, 044735, 063057, PATHMEM - 1, 1 },
+};
+
+static void viterbi_case(const viterbi_code& code, double ebn0)
+{
+	vector<int> bits(VITERBI_BITS);
+	vector<unsigned char> sym(2 * VITERBI_BITS);
+	encoder enc(code.k, code.poly1, code.poly2);
+	double sigma = 100.0 / sqrt(pow(10.0, ebn0 / 10.0));
+
+	random_seed = code.k;
+	for (int i = 0; i < VITERBI_BITS; i++) {
+		bits[i] = random_next() & 1;
+		int s = enc.encode(bits[i]);
+		for (int j = 0; j < 2; j++) {
+			double v = 128.0 + ((s >> j) & 1 ? 100.0 : -100.0) + random_gauss(sigma);
+			sym[2 * i + j] = (unsigned char)max(0.0, min(255.0, floor(v + 0.5)));
+		}
+	}
+
+	viterbi dec(code.k, code.poly1, code.poly2);
+	dec.settraceback(code.traceback);
+	dec.setchunksize(code.chunksize);
+
+	vector<int> out;
+	out.reserve(VITERBI_BITS);
+	for (int i = 0; i < VITERBI_BITS; i++) {
+		int c = dec.decode(&sym[2 * i], NULL);
+		if (c == -1)
+			continue;
+		for (int j = code.chunksize - 1; j >= 0; j--)
+			out.push_back((c >> j) & 1);
+	}
+
+	size_t errors = VITERBI_BITS, delay = 0;
+	for (size_t d = 0; d <= PATHMEM + 8 && d < out.size(); d++) {
+		size_t e = 0;
+		for (size_t i = d; i < out.size(); i++)
+			e += out[i] != bits[i - d];
+		if (e < errors) {
+			errors = e;
+			delay = d;
+		}
+	}
+	size_t checked = out.size() > delay ? out.size() - delay : 0;
+
+	long n = 0;
+	double t = cpu_time(), t0 = t;
+	do {
+		for (int i = 0; i < VITERBI_BITS; i++)
+			dec.decode(&sym[2 * i], NULL);
+		n += VITERBI_BITS;
+		t = cpu_time();
+	} while (t - t0 < VITERBI_MIN_CPU);
+
+	char name[64];
+	snprintf(name, sizeof(name), "%s ebn0 %g dB", code.name, ebn0);
+	record_begin("viterbi", name);
+	record_value("k", code.k);
+	record_value("traceback", code.traceback);
+	record_value("chunksize", code.chunksize);
+	record_value("bits", n);
+	record_value("cpu_time", t - t0);
+	record_value("bits_per_sec", n / (t - t0));
+	record_value("bit_errors", errors);
+	record_value("ber", checked ? (double)errors / checked : 0.0);
+	record_end();
+}
+
+static bool bench_viterbi(const string& input)
+{
+	double ebn0 = 4.0;
+	if (!input.empty()) {
+		char* end;
+		ebn0 = strtod(input.c_str(), &end);
+		if (*end || end == input.c_str()) {
+			LOG_ERROR("Eb/N0 must be a number of dB: \"%s\"", input.c_str());
+			return false;
+		}
+	}
+
+	for (size_t i = 0; i < sizeof(viterbi_codes) / sizeof(*viterbi_codes); i++)
+		viterbi_case(viterbi_codes[i], ebn0);
+
+	return true;
+}
+
+// ----------------------------------------------------------------------------
+
+struct kernel_benchmark {
+	const char* name;
+	bool (*run)(const string& input);
+};
+
+static const kernel_benchmark kernels[] = {
+	{ "fft", bench_fft },
+	{ "mt63", bench_mt63 },
+	{ "ssdv", bench_ssdv },
+	{ "varicode", bench_varicode },
+	{ "viterbi", bench_viterbi },
+};
+
+// Runs the kernels given as NAME or NAME:INPUT in benchmark.kernels
+bool run_kernel_benchmarks(FILE* f)
+{
+	vector<const kernel_benchmark*> run;
+	vector<string> inputs;
+	for (size_t i = 0; i < benchmark.kernels.size(); i++) {
+		string name = benchmark.kernels[i], input;
+		string::size_type colon = name.find(':');
+		if (colon != string::npos) {
+			input = name.substr(colon + 1);
+			name.erase(colon);
+		}
+		size_t k;
+		for (k = 0; k < sizeof(kernels) / sizeof(*kernels); k++)
+			if (name == kernels[k].name)
+				break;
+		if (k == sizeof(kernels) / sizeof(*kernels)) {
+			LOG_ERROR("Unknown kernel \"%s\"", name.c_str());
+			return false;
+		}
+		run.push_back(&kernels[k]);
+		inputs.push_back(input);
+	}
+
+	json = f;
+	json_first = true;
+	for (size_t i = 0; i < run.size(); i++)
+		if (!run[i]->run(inputs[i]))
+			return false;
+
+	return true;
+}
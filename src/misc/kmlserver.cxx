@@ -242,6 +242,11 @@ class  KmlSrvImpl : public KmlServer {
 		std::string       m_kmlId ;   // Unique KML id for the placemark.
 		std::string       m_descrTxt ;// KML snippet.
 
+		/// The KML text of the placemark is kept until the placemark changes,
+		/// because most placemarks are unchanged when a category file is rewritten.
+		mutable std::string m_kmlText ;
+		mutable int         m_kmlTextStyle ; // Balloon style of m_kmlText, -1 if none.
+
 		/// Serialize the internal data to XML so they can be easily read.
 		void SerializeForReading( std::ostream & ostrm ) const {
 
@@ -276,7 +281,8 @@ class  KmlSrvImpl : public KmlServer {
 			const std::string       & kmlNam )
 		: m_coord( refCoo )
 		, m_altitude( altitude )
-		, m_styleNam( styleNam ) {
+		, m_styleNam( styleNam )
+		, m_kmlTextStyle( -1 ) {
 			/// The unique key is indeed the name and the time,
 			/// because an object such as a ship might move and come back to the same place.
 			/// We add a counter because during tests, the timestamps are too close.
@@ -289,15 +295,19 @@ class  KmlSrvImpl : public KmlServer {
 		}
 
 		/// Constructor for deserialization. Strings comes from the KML file.
-		PlacemarkT() : m_altitude(0.0) {}
+		PlacemarkT() : m_altitude(0.0), m_kmlTextStyle(-1) {}
 
 		void Clear() {
 			m_styleNam.clear();
 			m_kmlId.clear();
 			m_descrTxt.clear();
 			clear();
+			Modified();
 		}
 
+		/// Must be called after any change, so the KML text is written again.
+		void Modified() { m_kmlTextStyle = -1 ; }
+
 		/// Used when reading a KML file. Read coordinates and altitude from a string when reloading a KML file.
 		void SetCoordinates( const char * str ) {
 			double lon, lat ;
@@ -310,6 +320,7 @@ class  KmlSrvImpl : public KmlServer {
 				throw std::runtime_error(msg+str);
 			}
 			m_coord = CoordinateT::Pair( lon, lat );
+			Modified();
 		}
 
 		/// Used when reading a KML file. HTML entities are already removed. "+1" is for the "#".
@@ -323,6 +334,7 @@ class  KmlSrvImpl : public KmlServer {
 				LOG_INFO("Inconsistent URL style:%s",str );
 				m_styleNam = str ;
 			}
+			Modified();
 		}
 
 		/// Used when reading a KML file.
@@ -332,6 +344,7 @@ class  KmlSrvImpl : public KmlServer {
 			// into normal chars. We must do the reverse transformation.
 			StripHtmlTags(strm,str);
 			m_kmlId = strm.str();
+			Modified();
 		}
 
 		/// Just add the events without suppressing duplicate information.
@@ -356,6 +369,7 @@ class  KmlSrvImpl : public KmlServer {
 				evtTim = time(NULL);
 			}
 			insert( value_type( evtTim, custDat ) );
+			Modified();
 		}
 
 		const CoordinateT::Pair & coordinates() const { return m_coord;}
@@ -370,7 +384,7 @@ class  KmlSrvImpl : public KmlServer {
 		}
 
 		/// Used when several PlacemarkT with the same kmlNam but different styles. Keep the first only.
-		void style(const std::string & styl) { m_styleNam = styl; }
+		void style(const std::string & styl) { m_styleNam = styl; Modified(); }
 
 		/// This is NOT the Euclidian distance but tries to reflect a position change on a 3D map.
 		double distance_to( const PlacemarkT & refOther ) const {
@@ -392,6 +406,7 @@ class  KmlSrvImpl : public KmlServer {
 			} else {
 				insert( refOther.begin(), refOther.end() );
 			}
+			Modified();
 		} // PlacemarkT::concatenate
 
 		/// This transforms our coordinates into KML ones.
@@ -402,8 +417,22 @@ class  KmlSrvImpl : public KmlServer {
 				<< m_altitude ;
 		}
 
-		/// Writes the placemark to a KML stream.
+		/// Writes the placemark to a KML stream. The text is made again only if the
+		/// placemark changed. kmlNam is the key of the placemark, which does not change.
 		void Serialize( std::ostream & ostrm, const std::string & kmlNam, int balloon_style ) const
+		{
+			if( m_kmlTextStyle != balloon_style ) {
+				std::stringstream strm ;
+				SerializeText( strm, kmlNam, balloon_style );
+				m_kmlText = strm.str();
+				m_kmlTextStyle = balloon_style ;
+			}
+			ostrm << m_kmlText ;
+		}
+
+	private:
+		/// Makes the KML text of the placemark.
+		void SerializeText( std::ostream & ostrm, const std::string & kmlNam, int balloon_style ) const
 		{
 			// Range of events which occured at this place.
 			const_reverse_iterator beEvt = rbegin(), enEvt = rend();
@@ -574,7 +603,7 @@ class  KmlSrvImpl : public KmlServer {
 			SerializeForReading( ostrm );
 
 			ostrm << "</Placemark>\n";
-		} // PlacemarkT::Serialize
+		} // PlacemarkT::SerializeText
 	}; // PlacemarkT
 
 	/** The placemark name is unique wrt to the application.
@@ -607,23 +636,15 @@ class  KmlSrvImpl : public KmlServer {
 		/// called by the subthread in charge of flushing PlacemarkT to the KML file.
 		void DirectInsert( const value_type & refVL, double merge_dist )
 		{
-			/// Not needed to use equal_range because we need the last placemark matching
-			/// this key, and this iterator is forward_iterator only.
-			iterator it = find( refVL.first ), en = end() ;
-			if( it == en ) {
+			/// The last placemark with this name is just before the upper bound.
+			/// A moving object may have many placemarks, so they are not walked through.
+			iterator next = upper_bound( refVL.first ), last = next ;
+			if( next == begin() || (--last)->first != refVL.first ) {
 				// LOG_INFO("Cannot find '%s'", refVL.first.c_str() );
-				it = insert( end(), refVL );
+				insert( next, refVL );
 				return;
 			}
 
-			/// Searches for the last element with the same key.
-			iterator last = it, next = it ;
-			++next ;
-			while( next != en && next->first == refVL.first ) {
-				last = next;
-				++next ;
-			}
-
 			double dist = last->second.distance_to( refVL.second );
 
 			/// We can reuse the last element because it is not too far from our coordinates.
@@ -731,6 +752,7 @@ class  KmlSrvImpl : public KmlServer {
 					++nbFullErased ;
 				} else if( itP != refP.begin() ) {
 					refP.erase( refP.begin(), itP );
+					refP.Modified();
 					++nbPartErased ;
 				}
 			}
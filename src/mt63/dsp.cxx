@@ -34,6 +34,10 @@
 #include <math.h>
 #include "dsp.h"
 
+#ifdef MT63_HAVE_FLOAT_SIMD
+bool dspFloatKernels = MT63_FLOAT_SIMD;
+#endif
+
 // ----------------------------------------------------------------------------
 
 double dspPower(double *X, int Len)
@@ -792,6 +796,10 @@ int dspFirFilter::Process(double_buff *Input)
 dspQuadrSplit::dspQuadrSplit()
 {
 	ExternShape = 1;
+	ShapeIQ = NULL;
+#ifdef MT63_HAVE_FLOAT_SIMD
+	ShapeIQF = NULL;
+#endif
 }
 
 dspQuadrSplit::~dspQuadrSplit()
@@ -800,6 +808,10 @@ dspQuadrSplit::~dspQuadrSplit()
 		free(ShapeI);
 		free(ShapeQ);
 	}
+	free(ShapeIQ);
+#ifdef MT63_HAVE_FLOAT_SIMD
+	free(ShapeIQF);
+#endif
 }
 
 void dspQuadrSplit::Free(void)
@@ -811,6 +823,13 @@ void dspQuadrSplit::Free(void)
 	}
 	ShapeI = NULL;
 	ShapeQ = NULL;
+	free(ShapeIQ);
+	ShapeIQ = NULL;
+#ifdef MT63_HAVE_FLOAT_SIMD
+	free(ShapeIQF);
+	ShapeIQF = NULL;
+	TapF.Free();
+#endif
 	Output.Free();
 }
 
@@ -831,6 +850,8 @@ int dspQuadrSplit::Preset(
 	Tap.Len = Len;
 	dspClearArray(Tap.Data, Tap.Len);
 	Rate = DecimateRate;
+	if (ShapeI && ShapeQ)
+		return InterleaveShape();
 	return 0;
 }
 
@@ -846,13 +867,33 @@ int dspQuadrSplit::ComputeShape(double LowOmega,double UppOmega,
 	if (dspRedspAllocArray(&ShapeQ, Len)) return -1;
 	dspWinFirI(LowOmega, UppOmega, ShapeI, Len, Window);
 	WinFirQ(LowOmega, UppOmega, ShapeQ, Len, Window);
+	return InterleaveShape();
+}
+
+// the I and Q taps side by side, so that one vector multiply-add
+// accumulates both sums
+int dspQuadrSplit::InterleaveShape(void)
+{
+	int t;
+	if (dspRedspAllocArray(&ShapeIQ, 2 * Len)) return -1;
+	for (t = 0; t < Len; t++) {
+		ShapeIQ[2 * t] = ShapeI[t];
+		ShapeIQ[2 * t + 1] = ShapeQ[t];
+	}
+#ifdef MT63_HAVE_FLOAT_SIMD
+	int Pairs = (Len + 1) / 2;
+	if (dspRedspAllocArray(&ShapeIQF, 4 * Pairs)) return -1;
+	for (t = 0; t < 2 * Len; t++)
+		ShapeIQF[t] = ShapeIQ[t];
+	for (; t < 4 * Pairs; t++)
+		ShapeIQF[t] = 0.0;
+#endif
 	return 0;
 }
 
 int dspQuadrSplit::Process(double_buff *Input)
 {
 	int err, i, s, t, o, l;
-	double SumI, SumQ;
 	double *Inp;
 	dspCmpx *Out;
 	int InpLen;
@@ -868,13 +909,50 @@ int dspQuadrSplit::Process(double_buff *Input)
 	err = Output.EnsureSpace( InpLen / Rate + 2);
 	if (err) return err;
 	Out = Output.Data;
-	for (l = Tap.Len-Len,o = 0, i = 0; i < l; i += Rate) {
-		for (SumI = SumQ = 0.0, s = i,t = 0; t < Len; t++,s++) {
-			SumI += Inp[s] * ShapeI[t];
-			SumQ += Inp[s] * ShapeQ[t];
+#ifdef MT63_HAVE_FLOAT_SIMD
+	if (dspFloatKernels) {
+		err = ProcessFloat(&i, &o);
+		if (err) return err;
+	}
+	else
+#endif
+	{
+#ifdef MT63_HAVE_SIMD
+// four outputs at a time, each with its own (I, Q) sum
+		dspVec2 Sum0, Sum1, Sum2, Sum3, Shape;
+		l = Tap.Len-Len;
+		for (o = 0, i = 0; i + 3 * Rate < l; i += 4 * Rate) {
+			Sum0 = Sum1 = Sum2 = Sum3 = dspVec2();
+			for (s = i, t = 0; t < Len; t++, s++) {
+				__builtin_memcpy(&Shape, ShapeIQ + 2 * t, sizeof(Shape));
+				Sum0 += Inp[s] * Shape;
+				Sum1 += Inp[s + Rate] * Shape;
+				Sum2 += Inp[s + 2 * Rate] * Shape;
+				Sum3 += Inp[s + 3 * Rate] * Shape;
+			}
+			__builtin_memcpy(&Out[o++], &Sum0, sizeof(Sum0));
+			__builtin_memcpy(&Out[o++], &Sum1, sizeof(Sum1));
+			__builtin_memcpy(&Out[o++], &Sum2, sizeof(Sum2));
+			__builtin_memcpy(&Out[o++], &Sum3, sizeof(Sum3));
 		}
-		Out[o].re=SumI;
-		Out[o++].im=SumQ;
+		for (; i < l; i += Rate) {
+			for (Sum0 = dspVec2(), s = i, t = 0; t < Len; t++, s++) {
+				__builtin_memcpy(&Shape, ShapeIQ + 2 * t, sizeof(Shape));
+				Sum0 += Inp[s] * Shape;
+			}
+			__builtin_memcpy(&Out[o++], &Sum0, sizeof(Sum0));
+		}
+#else
+		double SumI, SumQ;
+		for (l = Tap.Len-Len,o = 0, i = 0; i < l; i += Rate) {
+			for (SumI = SumQ = 0.0, s = i,t = 0; t < Len; t++,s++) {
+				SumI += Inp[s] * ShapeI[t];
+				SumQ += Inp[s] * ShapeQ[t];
+			}
+			Out[o].re=SumI;
+			Out[o++].im=SumQ;
+		}
+#endif
 	}
 	Tap.Len -= i;
 	dspMoveArray(Tap.Data,Tap.Data+i,Tap.Len);
@@ -883,6 +961,64 @@ int dspQuadrSplit::Process(double_buff *Input)
 	return 0;
 }
 
+#ifdef MT63_HAVE_FLOAT_SIMD
+// The float loop stores every input sample twice, so that one vector
+// (x[s], x[s], x[s+1], x[s+1]) times (I[t], Q[t], I[t+1], Q[t+1])
+// accumulates two taps of both sums; the two halves are added at the end.
+static inline void dspStoreSum(dspCmpx &Out, const dspVec4f &Sum)
+{
+	Out.re = Sum[0] + Sum[2];
+	Out.im = Sum[1] + Sum[3];
+}
+
+int dspQuadrSplit::ProcessFloat(int *InpUsed, int *OutLen)
+{
+	int i, s, t, o, l;
+	int Pairs = (Len + 1) / 2;
+	double *Inp = Tap.Data;
+	dspCmpx *Out = Output.Data;
+	float *InpF;
+	dspVec4f Sum0, Sum1, Sum2, Sum3, Shape, x;
+
+	if (TapF.EnsureSpace(2 * Tap.Len + 2)) return -1;
+	InpF = TapF.Data;
+	for (s = 0; s < Tap.Len; s++)
+		InpF[2 * s] = InpF[2 * s + 1] = Inp[s];
+	InpF[2 * s] = InpF[2 * s + 1] = 0.0; // read by the padding tap
+
+	l = Tap.Len-Len;
+	for (o = 0, i = 0; i + 3 * Rate < l; i += 4 * Rate) {
+		Sum0 = Sum1 = Sum2 = Sum3 = dspVec4f();
+		for (s = 2 * i, t = 0; t < Pairs; t++, s += 4) {
+			__builtin_memcpy(&Shape, ShapeIQF + 4 * t, sizeof(Shape));
+			__builtin_memcpy(&x, InpF + s, sizeof(x));
+			Sum0 += x * Shape;
+			__builtin_memcpy(&x, InpF + s + 2 * Rate, sizeof(x));
+			Sum1 += x * Shape;
+			__builtin_memcpy(&x, InpF + s + 4 * Rate, sizeof(x));
+			Sum2 += x * Shape;
+			__builtin_memcpy(&x, InpF + s + 6 * Rate, sizeof(x));
+			Sum3 += x * Shape;
+		}
+		dspStoreSum(Out[o++], Sum0);
+		dspStoreSum(Out[o++], Sum1);
+		dspStoreSum(Out[o++], Sum2);
+		dspStoreSum(Out[o++], Sum3);
+	}
+	for (; i < l; i += Rate) {
+		for (Sum0 = dspVec4f(), s = 2 * i, t = 0; t < Pairs; t++, s += 4) {
+			__builtin_memcpy(&Shape, ShapeIQF + 4 * t, sizeof(Shape));
+			__builtin_memcpy(&x, InpF + s, sizeof(x));
+			Sum0 += x * Shape;
+		}
+		dspStoreSum(Out[o++], Sum0);
+	}
+	*InpUsed = i;
+	*OutLen = o;
+	return 0;
+}
+#endif
+
 // ----------------------------------------------------------------------------
 // reverse of dspQuadrSplit: interpolates and combines the I/Q
 // back into 'real' signal.
@@ -2010,6 +2146,11 @@ dsp_r2FFT::dsp_r2FFT()
 {
 	BitRevIdx = NULL;
 	Twiddle = NULL; /* Window=NULL; */
+	TwiddleVec = NULL;
+#ifdef MT63_HAVE_FLOAT_SIMD
+	TwiddleVecF = NULL;
+	DataF = NULL;
+#endif
 }
 
 // destructor: free twiddles, bit-reverse lookup and window tables
@@ -2017,6 +2158,11 @@ dsp_r2FFT::~dsp_r2FFT()
 {
 	free(BitRevIdx);
 	free(Twiddle); /* free(Window); */
+	free(TwiddleVec);
+#ifdef MT63_HAVE_FLOAT_SIMD
+	free(TwiddleVecF);
+	free(DataF);
+#endif
 }
 
 void dsp_r2FFT::Free(void)
@@ -2025,6 +2171,14 @@ void dsp_r2FFT::Free(void)
 	BitRevIdx = NULL;
 	free(Twiddle);
 	Twiddle = NULL;
+	free(TwiddleVec);
+	TwiddleVec = NULL;
+#ifdef MT63_HAVE_FLOAT_SIMD
+	free(TwiddleVecF);
+	TwiddleVecF = NULL;
+	free(DataF);
+	DataF = NULL;
+#endif
 }
 
 // ..........................................................................
@@ -2108,6 +2262,36 @@ int dsp_r2FFT::Preset(int size)
 		Twiddle[idx].im = sin(dspPhase);
 //printf("%2d,%6.4f,%6.4f,%6.4f\n", idx,dspPhase,Twiddle[idx].re,Twiddle[idx].im); 
 	}
+// (W.re, W.re, W.im, -W.im) for the vector butterflies
+	err = dspRedspAllocArray(&TwiddleVec, 4 * Size);
+	if (err) goto Error;
+	for (idx = 0; idx < Size; idx++) {
+		TwiddleVec[4 * idx] = TwiddleVec[4 * idx + 1] = Twiddle[idx].re;
+		TwiddleVec[4 * idx + 2] = Twiddle[idx].im;
+		TwiddleVec[4 * idx + 3] = -Twiddle[idx].im;
+	}
+#ifdef MT63_HAVE_FLOAT_SIMD
+// for each pass after the first, the twiddles of butterflies k and k+1 as
+// (W.re, W.re, W'.re, W'.re) and (W.im, -W.im, W'.im, -W'.im)
+	err = dspRedspAllocArray(&TwiddleVecF, 4 * Size);
+	if (err) goto Error;
+	err = dspRedspAllocArray(&DataF, 2 * Size);
+	if (err) goto Error;
+	{
+		float *W = TwiddleVecF;
+		int Groups, GroupHalfSize, k;
+		for (Groups = Size/4, GroupHalfSize = 2; Groups; Groups >>= 1, GroupHalfSize <<= 1)
+			for (k = 0; k < GroupHalfSize; k += 2, W += 8) {
+				dspCmpx &W0 = Twiddle[k * Groups], &W1 = Twiddle[(k + 1) * Groups];
+				W[0] = W[1] = W0.re;
+				W[2] = W[3] = W1.re;
+				W[4] = W0.im;
+				W[5] = -W0.im;
+				W[6] = W1.im;
+				W[7] = -W1.im;
+			}
+	}
+#endif
 //printf("\n\nidx,BitRevIdx\n");
 	for (ridx = 0, idx = 0; idx < Size; idx++) {
 		for (ridx = 0, mask = Size/2, rmask = 1; mask; mask >>= 1, rmask <<= 1) {
@@ -2130,10 +2314,94 @@ Error:
 // radix-2 FFT: the first and the second pass are by hand
 // looks like there is no gain by separating the second pass
 // and even the first pass is in question ?
+#ifdef MT63_HAVE_FLOAT_SIMD
+// the passes in float, two butterflies per vector: the first pass is done
+// while converting to float, and the result is converted back to double
+void dsp_r2FFT::CoreProcFloat(dspCmpx x[])
+{
+	int Groups, GroupHalfSize, Group, Bf, k;
+	float *y = DataF;
+	const float *W = TwiddleVecF;
+	dspVec4f x0, x1, x1W, Wr, Wi;
+	for (Bf = 0; Bf < Size; Bf += 2) { // first pass
+		float r0 = x[Bf].re, i0 = x[Bf].im;
+		float r1 = x[Bf+1].re, i1 = x[Bf+1].im;
+		y[2 * Bf] = r0 + r1;
+		y[2 * Bf + 1] = i0 + i1;
+		y[2 * Bf + 2] = r0 - r1;
+		y[2 * Bf + 3] = i0 - i1;
+	}
+	for (Groups = Size/4, GroupHalfSize = 2; Groups; Groups >>= 1, GroupHalfSize <<= 1) {
+		for (Group = 0, Bf = 0; Group < Groups; Group++, Bf += GroupHalfSize)
+			for (k = 0; k < GroupHalfSize; k += 2, Bf += 2) {
+				__builtin_memcpy(&Wr, W + 4 * k, sizeof(Wr));
+				__builtin_memcpy(&Wi, W + 4 * k + 4, sizeof(Wi));
+				__builtin_memcpy(&x0, y + 2 * Bf, sizeof(x0));
+				__builtin_memcpy(&x1, y + 2 * (Bf + GroupHalfSize), sizeof(x1));
+				dspVec4f x1s = { x1[1], x1[0], x1[3], x1[2] };
+				x1W = x1 * Wr + x1s * Wi;
+				x1 = x0 - x1W;
+				x0 = x0 + x1W;
+				__builtin_memcpy(y + 2 * Bf, &x0, sizeof(x0));
+				__builtin_memcpy(y + 2 * (Bf + GroupHalfSize), &x1, sizeof(x1));
+			}
+		W += 4 * GroupHalfSize;
+	}
+	for (Bf = 0; Bf < Size; Bf++) {
+		x[Bf].re = y[2 * Bf];
+		x[Bf].im = y[2 * Bf + 1];
+	}
+}
+#endif
+
+#ifdef MT63_HAVE_SIMD
+// the same passes with each dspCmpx in a vector, FFTbf multiplies x1 by
+// the conjugate of W as (x1.re, x1.im) * (W.re, W.re) + (x1.im, x1.re) * (W.im, -W.im)
 void dsp_r2FFT::CoreProc(dspCmpx x[])
 {
 	int Groups, GroupHalfSize, Group, Bf, TwidIdx;
 	int HalfSize = Size/2;
+	dspVec2 x0, x1, x1W, Wr, Wi;
+#ifdef MT63_HAVE_FLOAT_SIMD
+	if (dspFloatKernels && Size >= 4) {
+		CoreProcFloat(x);
+		return;
+	}
+#endif
+	for (Bf = 0; Bf < Size; Bf += 2) { // first pass
+		__builtin_memcpy(&x0, &x[Bf], sizeof(x0));
+		__builtin_memcpy(&x1, &x[Bf+1], sizeof(x1));
+		x1W = x0 - x1;
+		x0 = x0 + x1;
+		__builtin_memcpy(&x[Bf], &x0, sizeof(x0));
+		__builtin_memcpy(&x[Bf+1], &x1W, sizeof(x1W));
+	}
+	for (Groups = HalfSize/2, GroupHalfSize = 2; Groups; Groups >>= 1, GroupHalfSize <<= 1)
+		for (Group = 0, Bf = 0; Group < Groups; Group++, Bf += GroupHalfSize)
+			for (TwidIdx = 0; TwidIdx < HalfSize; TwidIdx += Groups, Bf++) {
+				__builtin_memcpy(&Wr, TwiddleVec + 4 * TwidIdx, sizeof(Wr));
+				__builtin_memcpy(&Wi, TwiddleVec + 4 * TwidIdx + 2, sizeof(Wi));
+				__builtin_memcpy(&x0, &x[Bf], sizeof(x0));
+				__builtin_memcpy(&x1, &x[Bf + GroupHalfSize], sizeof(x1));
+				dspVec2 x1s = { x1[1], x1[0] };
+				x1W = x1 * Wr + x1s * Wi;
+				x1 = x0 - x1W;
+				x0 = x0 + x1W;
+				__builtin_memcpy(&x[Bf], &x0, sizeof(x0));
+				__builtin_memcpy(&x[Bf + GroupHalfSize], &x1, sizeof(x1));
+		}
+}
+#else
+void dsp_r2FFT::CoreProc(dspCmpx x[])
+{
+	int Groups, GroupHalfSize, Group, Bf, TwidIdx;
+	int HalfSize = Size/2;
+#ifdef MT63_HAVE_FLOAT_SIMD
+	if (dspFloatKernels && Size >= 4) {
+		CoreProcFloat(x);
+		return;
+	}
+#endif
 	for (Bf = 0; Bf < Size; Bf += 2)
 		FFT2(x[Bf], x[Bf+1]); // first pass
   // for(Bf=0; Bf<Size; Bf+=4) FFT4(x[Bf],x[Bf+1],x[Bf+2],x[Bf+3]); // second
@@ -2144,6 +2412,7 @@ void dsp_r2FFT::CoreProc(dspCmpx x[])
 /* printf("%2d %2d %2d\n",Bf,Bf+GroupHalfSize,TwidIdx); */
 		}
 }
+#endif
 
 // ..........................................................................
 
@@ -98,7 +98,6 @@ int MT63tx::Preset(double freq, int BandWidth, int LongInterleave)
 	omega_low *= (M_PI / 4000);
 	omega_high *= (M_PI / 4000);
 
-	mask = FFT.Size - 1;
 	DataCarriers = 64;
 
 	switch(BandWidth) {
@@ -148,6 +147,7 @@ int MT63tx::Preset(double freq, int BandWidth, int LongInterleave)
 		goto Error;
 	if (FFT.Preset(WindowLen))
 		goto Error;
+	mask = FFT.Size - 1;
 	if (Window.Preset(WindowLen, SymbolSepar / 2, TxWindow))
 		goto Error;
 
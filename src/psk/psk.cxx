@@ -35,6 +35,7 @@
 #include <iomanip>
 
 #include "psk.h"
+#include "simd.h"
 #include "main.h"
 #include "fl_digi.h"
 #include "trx.h"
@@ -104,8 +105,11 @@ void psk::rx_init()
 {
 	for (int car = 0; car < numcarriers; car++) {
 		phaseacc[car] = 0;
+		rxnco_i[car] = 1.0;
+		rxnco_q[car] = 0.0;
 		prevsymbol[car] = cmplx (1.0, 0.0);
 	}
+	rxstep_freq = -1.0;
 	quality		= cmplx (0.0, 0.0);
 	if (_pskr) {
 		// MFSK varicode instead of psk
@@ -1175,11 +1179,64 @@ void psk::update_syncscope()
 
 char bitstatus[100];
 
+//=====================================================================
+// Mix n input samples with every carrier of the bank.  The carrier
+// phasors are rotated two at a time in a vector, and the mixed samples
+// of each carrier are written to rxmix for the block filters.
+//=====================================================================
+
+#ifdef SIMD_VECTORS
+typedef double psk_v2d __attribute__((vector_size(16)));
+#endif
+
+void psk::rx_mix(const double *buf, int n)
+{
+	int ncar = (int)numcarriers;
+	int car = 0;
+
+#ifdef SIMD_VECTORS
+	for (; car + 2 <= ncar; car += 2) {
+		psk_v2d ni, nq, si, sq, t;
+		__builtin_memcpy(&ni, &rxnco_i[car], sizeof(ni));
+		__builtin_memcpy(&nq, &rxnco_q[car], sizeof(nq));
+		__builtin_memcpy(&si, &rxstep_i[car], sizeof(si));
+		__builtin_memcpy(&sq, &rxstep_q[car], sizeof(sq));
+		cmplx *m0 = rxmix[car];
+		cmplx *m1 = rxmix[car + 1];
+		for (int i = 0; i < n; i++) {
+			psk_v2d x = psk_v2d() + buf[i];
+			psk_v2d mi = x * ni;
+			psk_v2d mq = x * nq;
+			m0[i] = cmplx (mi[0], mq[0]);
+			m1[i] = cmplx (mi[1], mq[1]);
+			t = ni * si - nq * sq;
+			nq = ni * sq + nq * si;
+			ni = t;
+		}
+		__builtin_memcpy(&rxnco_i[car], &ni, sizeof(ni));
+		__builtin_memcpy(&rxnco_q[car], &nq, sizeof(nq));
+	}
+#endif
+	for (; car < ncar; car++) {
+		cmplx nco = cmplx (rxnco_i[car], rxnco_q[car]);
+		cmplx step = cmplx (rxstep_i[car], rxstep_q[car]);
+		cmplx *m = rxmix[car];
+		for (int i = 0; i < n; i++) {
+			m[i] = buf[i] * nco;
+			nco *= step;
+		}
+		rxnco_i[car] = nco.real();
+		rxnco_q[car] = nco.imag();
+	}
+}
+
 int psk::rx_process(const double *buf, int len)
 {
-	double delta[MAX_CARRIERS], frequencies[MAX_CARRIERS];
+	double frequencies[MAX_CARRIERS];
 	cmplx z, z2[MAX_CARRIERS];
 	bool can_rx_symbol = false;
+	int n, ndec = 0;
+	int lastcar = (int)numcarriers - 1;
 
 	if (numcarriers == 1) {
 		if (!progdefaults.report_when_visible ||
@@ -1189,23 +1246,24 @@ int psk::rx_process(const double *buf, int len)
 			evalpsk->sigdensity();
 	}
 
-	frequencies[0] = frequency + ((-1 * numcarriers) + 1) * inter_carrier / 2;
-	delta[0] = TWOPI * frequencies[0] / samplerate;
-	for (int car = 1; car < numcarriers; car++) {
+// the NCO steps change with the frequency, afc moves it for the next buffer
+	if (frequency != rxstep_freq) {
+		rxstep_freq = frequency;
+		frequencies[0] = frequency + ((-1 * numcarriers) + 1) * inter_carrier / 2;
+		for (int car = 1; car < numcarriers; car++)
 			frequencies[car] = frequencies[car - 1] + inter_carrier;
-			delta[car] = TWOPI * frequencies[car] / samplerate;
+		for (int car = 0; car < numcarriers; car++) {
+			rxstep_i[car] = cos(TWOPI * frequencies[car] / samplerate);
+			rxstep_q[car] = sin(TWOPI * frequencies[car] / samplerate);
+		}
 	}
 
-	while (len-- > 0) {
+	for (int ptr = 0; ptr < len; ptr += n) {
+		n = len - ptr;
+		if (n > PSK_MIXBLOCK) n = PSK_MIXBLOCK;
 
-	   for (int car = 0; car < numcarriers; car++) {
-
-		// Mix with the internal NCO
-		z = cmplx ( *buf * cos(phaseacc[car]), *buf * sin(phaseacc[car]) );
-
-		phaseacc[car] += delta[car];
-		if (phaseacc[car] > M_PI)
-			phaseacc[car] -= TWOPI;
+		// Mix the block with the internal NCO of every carrier
+		rx_mix(buf + ptr, n);
 
 		// Filter and downsample
 		// by 16 (psk31, qpsk31)
@@ -1213,13 +1271,15 @@ int psk::rx_process(const double *buf, int len)
 		// by  4 (psk125, qpsk125)
 		// by  2 (psk250, qpsk250)
 		// by  1 (psk500, qpsk500) = no down sampling
-		// first filter
-		if (fir1[car]->run( z, z )) { // fir1 returns true every Nth sample
-		    // final filter
-		    fir2[car]->run( z, z2[car] ); // fir2 returns value on every sample
+		// first filter, the decimation counters of all carriers agree
+		for (int car = 0; car < numcarriers; car++)
+			ndec = fir1[car]->run( rxmix[car], n, rxdec[car] );
 
-		    //On last carrier processing
-		    if (car == numcarriers - 1) { 
+		for (int i = 0; i < ndec; i++) {
+			// final filter
+			for (int car = 0; car < numcarriers; car++)
+				fir2[car]->run( rxdec[car][i], z2[car] ); // fir2 returns value on every sample
+			z = rxdec[lastcar][i];
 
 			calcSN_IMD(z); //JD OR all carriers together check logic???
 
@@ -1334,17 +1394,21 @@ int psk::rx_process(const double *buf, int len)
 				update_syncscope();
 				afc();
 			}
-		    }
 
+			if (can_rx_symbol) {
+				for (int car = 0; car < numcarriers; car++) {
+					rx_symbol(z2[car], car);
+				}
+				can_rx_symbol = false;
+			}
 		}
-	   }
-	   if (can_rx_symbol) {
-		for (int car = 0; car < numcarriers; car++) {
-			rx_symbol(z2[car], car);
-		}
-	   	can_rx_symbol = false;
-	   }
- 	   buf++;
+	}
+
+// keep the NCO phasors on the unit circle
+	for (int car = 0; car < numcarriers; car++) {
+		double mag = sqrt(rxnco_i[car] * rxnco_i[car] + rxnco_q[car] * rxnco_q[car]);
+		rxnco_i[car] /= mag;
+		rxnco_q[car] /= mag;
 	}
 
 	if (sigsearch)
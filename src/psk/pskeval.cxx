@@ -48,28 +48,34 @@ void pskeval::sigdensity() {
 	int ihbw = (int)(0.6*bw);
 	int ibw = 2 * ihbw;
 
-	double *vals = new double[ibw];
+	double *vals;
 	double sig = 0.0;
-	double val = 0.0;
 
 	int low = progdefaults.LowFreqCutoff;
 	if (low < ihbw) low = ihbw;
 	int high = progdefaults.HighFreqCutoff;
 	if (high > FFT_LEN - ihbw) high = FFT_LEN - ihbw;
 	int nbr = high - low;
+	if (nbr < 0) nbr = 0;
 
 	sigmin = 1e6;
 
-	for (int i = 0; i < ibw; i++) {
-		val = vals[i] = wf->Pwr(i + low - ihbw);
-		sig += val;
+// the bins of one spectrum frame
+	vals = new double[nbr + ibw];
+	for (;;) {
+		spectrum::snapshot s(*wf->powerSpectrum());
+		for (int i = 0; i < nbr + ibw; i++)
+			vals[i] = s.power(i + low - ihbw);
+		if (s.valid())
+			break;
 	}
-	for (int i = 0, j = 0; i < nbr; i++) {
+
+	for (int i = 0; i < ibw; i++)
+		sig += vals[i];
+	for (int i = 0; i < nbr; i++) {
 		sigpwr[i + low] = decayavg(sigpwr[i + low], sig, 32);
-		sig -= vals[j];
-		val = vals[j] = wf->Pwr(i + ihbw + low);
-		sig += val;
-		if (++j == ibw) j = 0;
+		sig -= vals[i];
+		sig += vals[i + ibw];
 		if (sig < sigmin) sigmin = sig;
 	}
 
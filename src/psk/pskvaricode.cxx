@@ -324,6 +324,22 @@ static unsigned int varicodetab2[] = {
 	0xAF5, 0xAF7, 0xAFB, 0xAFD, 0xAFF, 0xB55, 0xB57, 0xB5B
 };
 
+// The decoding table indexed by the code, so that a symbol is decoded
+// with a single lookup.  Filled in from varicodetab2 at startup.
+#define VARICODE_CODES 4096
+
+static short varicode_index[VARICODE_CODES];
+
+static bool varicode_index_init(void)
+{
+	for (int i = 0; i < VARICODE_CODES; i++)
+		varicode_index[i] = -1;
+	for (int i = 255; i >= 0; i--)
+		varicode_index[varicodetab2[i]] = i;
+	return true;
+}
+static bool varicode_index_ok = varicode_index_init();
+
 const char *psk_varicode_encode(unsigned char c)
 {
 	return varicodetab1[c];
@@ -331,9 +347,8 @@ const char *psk_varicode_encode(unsigned char c)
 
 int psk_varicode_decode(unsigned int symbol)
 {
-	for (int i = 0; i < 256; i++)
-		if (symbol == varicodetab2[i])
-			return i;
+	if (symbol < VARICODE_CODES)
+		return varicode_index[symbol];
 	return -1;
 }
 
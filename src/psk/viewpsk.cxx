@@ -76,7 +76,9 @@ void viewpsk::init()
 	lowfreq = progdefaults.LowFreqCutoff;
 
 	for (int i = 0; i < MAXCHANNELS; i++) {
-		channel[i].phaseacc = 0;
+		channel[i].nco = cmplx (1.0, 0.0);
+		channel[i].ncofreq = 0.0;
+		channel[i].ncostep = cmplx (1.0, 0.0);
 		channel[i].prevsymbol = cmplx (1.0, 0.0);
 		channel[i].quality = cmplx (0.0, 0.0);
 		channel[i].shreg = 0;
@@ -340,8 +342,9 @@ int viewpsk::rx_process(const double *buf, int len)
 {
 	double sum;
 	double ampsum;
-	int idx;
+	int idx, n;
 	cmplx z, z2;
+	cmplx zmix[VMIXBLOCK];
 
 	if (nchannels != progdefaults.VIEWERchannels || lowfreq != progdefaults.LowFreqCutoff)
 		init();
@@ -349,12 +352,25 @@ int viewpsk::rx_process(const double *buf, int len)
 // process all channels
 	for (int ch = 0; ch < nchannels; ch++) {
 		if (channel[ch].frequency == NULLFREQ) continue;
-		for (int ptr = 0; ptr < len; ptr++) {
+// mix and decimate one fir1 output at a time, afc may move the
+// channel frequency at any symbol
+		for (int ptr = 0; ptr < len; ptr += n) {
+			n = channel[ch].fir1->samples_to_output();
+			if (n > len - ptr) n = len - ptr;
+			if (n > VMIXBLOCK) n = VMIXBLOCK;
 // Mix with the internal NCO for each channel
-			z = cmplx ( buf[ptr] * cos(channel[ch].phaseacc), buf[ptr] * sin(channel[ch].phaseacc) );
-			channel[ch].phaseacc += 2.0 * M_PI * channel[ch].frequency / VPSKSAMPLERATE;
+			if (channel[ch].frequency != channel[ch].ncofreq) {
+				channel[ch].ncofreq = channel[ch].frequency;
+				channel[ch].ncostep = cmplx (
+					cos(2.0 * M_PI * channel[ch].ncofreq / VPSKSAMPLERATE),
+					sin(2.0 * M_PI * channel[ch].ncofreq / VPSKSAMPLERATE) );
+			}
+			for (int i = 0; i < n; i++) {
+				zmix[i] = buf[ptr + i] * channel[ch].nco;
+				channel[ch].nco *= channel[ch].ncostep;
+			}
 // filter & decimate
-			if (channel[ch].fir1->run( z, z )) {
+			if (channel[ch].fir1->run( zmix, n, &z )) {
 				channel[ch].fir2->run( z, z2 );
 				idx = (int) channel[ch].bitclk;
 				sum = 0.0;
@@ -378,6 +394,8 @@ int viewpsk::rx_process(const double *buf, int len)
 				}
 			}
 		}
+// keep the NCO amplitude from drifting
+		channel[ch].nco /= abs(channel[ch].nco);
 	}
 
 	findsignals();
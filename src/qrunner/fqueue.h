@@ -25,7 +25,9 @@
 
 #include <stdexcept>
 #include <cassert>
-#include "ringbuffer.h"
+#include <new>
+#include <stdint.h>
+#include "timeops.h"
 #include "util.h"
 // #include <iostream>
 // #include <cstdio>
@@ -52,51 +54,120 @@ private:
         F f;
 };
 
+#define FQUEUE_CACHE_LINE 64
+#define FQUEUE_FUNC_SIZE 128
 
+// Fixed capacity queue of functors, any number of threads may push and one
+// thread pops.  Every functor is constructed in place in its own slot, no
+// memory is allocated after construction.
+//
+// Each slot has a sequence number: it is equal to the slot's position when
+// the slot is free for a producer, and to position + 1 when it holds a
+// functor for the consumer.  The producers claim positions with a CAS on
+// head, the consumer owns tail.  head and tail are on cache lines of their
+// own so that the producers and the consumer do not share a line.
 class fqueue
 {
-        typedef ringbuffer<char> fqueue_ringbuffer_t;
+        struct slot {
+                volatile size_t seq;
+                double stamp; // push time, for the latency counters
+                char pad[FQUEUE_CACHE_LINE - sizeof(size_t) - sizeof(double)];
+                union {
+                        char buf[FQUEUE_FUNC_SIZE];
+                        double align_d;
+                        void* align_p;
+                };
+        };
 
 public:
-        fqueue(size_t count = 2048, size_t blocksize_ = 128)
-                : blocksize(blocksize_)
+        struct stats_t {
+                size_t depth, max_depth;
+                unsigned long pushed, executed, dropped;
+                double latency_avg, latency_max; // seconds from push to pop
+        };
+
+        fqueue(size_t count = 2048)
         {
-		rb = new fqueue_ringbuffer_t(blocksize * count);
+                assert(powerof2(count));
+                nslots = count;
+                mask = count - 1;
+                mem = new char[count * sizeof(slot) + FQUEUE_CACHE_LINE];
+                slots = reinterpret_cast<slot*>(((uintptr_t)mem + FQUEUE_CACHE_LINE - 1) &
+                                                ~(uintptr_t)(FQUEUE_CACHE_LINE - 1));
+                for (size_t i = 0; i < count; i++)
+                        slots[i].seq = i;
+                head = tail = 0;
+                pushed = dropped = executed = 0;
+                max_depth = 0;
+                latency_sum = latency_max = 0.0;
         }
         ~fqueue()
         {
 		drop();
-		delete rb;
+		delete [] mem;
         }
 
-        bool empty(void) { return rb->read_space() == 0; }
-        bool full(void)  { return rb->write_space() == 0; }
-        size_t size(void) { return rb->read_space() / blocksize; }
+        bool empty(void) { return slots[tail & mask].seq != tail + 1; }
+        bool full(void)  { return head - tail >= nslots; }
+        size_t size(void) { return head - tail; }
 
         template <class T>
         bool push(const T& t)
         {
-                // If we have any space left at all, it will be at least
-                // a blocksize. It will not wrap around the end of the rb.
-                if (unlikely(rb->get_wv(wvec, blocksize) < blocksize))
-                        return false;
+                assert(sizeof(func_wrap<T>) <= FQUEUE_FUNC_SIZE);
+
+                size_t pos = head;
+                slot* s;
+                for (;;) {
+                        s = &slots[pos & mask];
+                        size_t seq = s->seq;
+                        read_memory_barrier();
+                        intptr_t dif = (intptr_t)seq - (intptr_t)pos;
+                        if (dif == 0) {
+                                if (__sync_bool_compare_and_swap(&head, pos, pos + 1))
+                                        break;
+                        }
+                        else if (dif < 0) { // full
+                                __sync_fetch_and_add(&dropped, 1);
+                                return false;
+                        }
+                        pos = head;
+                }
 
-                assert(blocksize >= sizeof(func_wrap<T>));
                 // we assume a no-throw ctor!
-                new (wvec[0].buf) func_wrap<T>(t);
-                rb->write_advance(blocksize);
+                new (s->buf) func_wrap<T>(t);
+                s->stamp = now();
+                __sync_fetch_and_add(&pushed, 1);
+                write_memory_barrier();
+                s->seq = pos + 1;
 
                 return true;
         }
 
         bool pop(bool exec = false)
         {
-		if (rb->get_rv(rvec, blocksize) < blocksize)
-			return false;
-		reinterpret_cast<func_base *>(rvec[0].buf)->destroy(exec);
-		rb->read_advance(blocksize);
+                slot* s = &slots[tail & mask];
+                if (s->seq != tail + 1)
+                        return false;
+                read_memory_barrier();
+
+                if (exec) {
+                        size_t depth = head - tail;
+                        if (depth > max_depth)
+                                max_depth = depth;
+                        double latency = now() - s->stamp;
+                        latency_sum += latency;
+                        if (latency > latency_max)
+                                latency_max = latency;
+                        executed++;
+                }
+                reinterpret_cast<func_base *>(s->buf)->destroy(exec);
+
+                full_memory_barrier();
+                s->seq = tail + nslots;
+                tail++;
 
-		return true;
+                return true;
         }
 
         bool execute(void) { return pop(true); }
@@ -109,10 +180,40 @@ public:
                 return n;
         }
 
+        void stats(stats_t& st)
+        {
+                st.depth = head - tail;
+                st.max_depth = max_depth;
+                st.pushed = pushed;
+                st.executed = executed;
+                st.dropped = dropped;
+                st.latency_avg = executed ? latency_sum / executed : 0.0;
+                st.latency_max = latency_max;
+        }
+
 protected:
-        fqueue_ringbuffer_t* rb;
-        fqueue_ringbuffer_t::vector_type rvec[2], wvec[2];
-        size_t blocksize;
+        static double now(void)
+        {
+                struct timespec ts;
+                clock_gettime(CLOCK_MONOTONIC, &ts);
+                return ts.tv_sec + ts.tv_nsec * 1e-9;
+        }
+
+        char* mem;
+        slot* slots;
+        size_t nslots, mask;
+
+        // producers
+        char pad0[FQUEUE_CACHE_LINE];
+        volatile size_t head;
+        volatile unsigned long pushed, dropped;
+        char pad1[FQUEUE_CACHE_LINE];
+        // consumer
+        volatile size_t tail;
+        unsigned long executed;
+        size_t max_depth;
+        double latency_sum, latency_max;
+        char pad2[FQUEUE_CACHE_LINE];
 };
 
 #endif // FQUEUE_H_
@@ -31,6 +31,9 @@
 #  include "compat.h"
 #endif
 #include <fcntl.h>
+#if HAVE_SYS_EVENTFD_H
+#  include <sys/eventfd.h>
+#endif
 
 #include <FL/Fl.H>
 
@@ -47,9 +50,14 @@
 #endif
 
 qrunner::qrunner()
-        : attached(false), inprog(false), drop_flag(false)
+        : wake_pending(0), attached(false), inprog(false), drop_flag(false)
 {
         fifo = new fqueue(FIFO_SIZE);
+#if HAVE_SYS_EVENTFD_H
+	if ((pfd[0] = pfd[1] = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) == -1)
+		throw qexception(errno);
+	return;
+#endif
 #ifndef __WOE32__
         if (pipe(pfd) == -1)
 #else
@@ -69,7 +77,8 @@ qrunner::~qrunner()
 {
         detach();
         close(pfd[0]);
-        close(pfd[1]);
+        if (pfd[1] != pfd[0])
+                close(pfd[1]);
         delete fifo;
 }
 
@@ -94,18 +103,18 @@ void qrunner::execute(int fd, void *arg)
 		return;
 	qr->inprog = true;
 
-	size_t n = QRUNNER_READ(fd, rbuf, FIFO_SIZE);
-	switch (n) {
-	case -1:
-		if (!QRUNNER_EAGAIN())
-			throw qexception(errno);
-		// else fall through
-	case 0:
-		break;
-	default:
-		while (n--)
-			qr->fifo->execute();
-	}
+	if (QRUNNER_READ(fd, rbuf, FIFO_SIZE) == -1 && !QRUNNER_EAGAIN())
+		throw qexception(errno);
+
+	// Requests pushed from here on write to the wakeup fd again.  Run at
+	// most one queue length, and wake up again for what is left, so that
+	// a thread that keeps pushing does not keep us here.
+	__sync_lock_release(&qr->wake_pending);
+	full_memory_barrier();
+	for (size_t n = FIFO_SIZE; n > 0 && qr->fifo->execute(); n--)
+		;
+	if (!qr->fifo->empty())
+		qr->wakeup();
 
 	qr->inprog = false;
 }
@@ -31,6 +31,7 @@
 #include <cmath>
 #include <cstring>
 #include <float.h>
+#include <unistd.h>
 #include <samplerate.h>
 
 #include "rsid.h"
@@ -77,6 +78,7 @@ const int cRsId::indices[] = {
 };
 
 cRsId::cRsId()
+	: tap(RSID_TAP_SIZE), tapreader(tap)
 {
 	int error;
 	src_state = src_new(progdefaults.sample_converter, 1, &error);
@@ -145,10 +147,64 @@ cRsId::cRsId()
 
 	reset();
 
+	rx_exit = false;
+	flush_request = false;
+	rx_samplerate = RSID_SAMPLE_RATE;
+	rx_centerfreq = 1000.0;
+	rx_reverse = false;
+	tap_count = sample_pos = 0;
+
+// one search band per processor, up to RSID_MAX_BANDS
+	nbands = 1;
+#ifdef _SC_NPROCESSORS_ONLN
+	long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+	if (ncpu > 1)
+		nbands = ncpu < RSID_MAX_BANDS ? (int)ncpu : RSID_MAX_BANDS;
+#endif
+	band_gen = 0;
+	band_count = bands_next = bands_pending = 0;
+	band_codes = 0;
+	band_tblsize = 0;
+	pthread_mutex_init(&band_mutex, NULL);
+	pthread_cond_init(&band_start, NULL);
+	pthread_cond_init(&band_done, NULL);
+	for (int i = 1; i < nbands; i++) {
+		if (pthread_create(&band_thread[i], NULL, band_loop, this) != 0) {
+			LOG_PERROR("pthread_create");
+			nbands = i;
+			break;
+		}
+	}
+
+	pthread_mutex_init(&rx_mutex, NULL);
+	pthread_cond_init(&rx_cond, NULL);
+	if (pthread_create(&rx_thread, NULL, rx_loop, this) != 0) {
+		LOG_PERROR("pthread_create");
+		abort();
+	}
 }
 
 cRsId::~cRsId()
 {
+	pthread_mutex_lock(&rx_mutex);
+	rx_exit = true;
+	pthread_cond_signal(&rx_cond);
+	pthread_mutex_unlock(&rx_mutex);
+	pthread_join(rx_thread, NULL);
+
+	pthread_mutex_lock(&band_mutex);
+	band_gen++;
+	pthread_cond_broadcast(&band_start);
+	pthread_mutex_unlock(&band_mutex);
+	for (int i = 1; i < nbands; i++)
+		pthread_join(band_thread[i], NULL);
+
+	pthread_cond_destroy(&rx_cond);
+	pthread_mutex_destroy(&rx_mutex);
+	pthread_cond_destroy(&band_done);
+	pthread_cond_destroy(&band_start);
+	pthread_mutex_destroy(&band_mutex);
+
 	delete [] pCodes1;
 	delete [] pCodes2;
 
@@ -221,13 +277,74 @@ void cRsId::CalculateBuckets(const rs_fft_type *pSpectrum, int iBegin, int iEnd)
 	}
 }
 
+//=============================================================================
+// The trx thread only copies its audio to the tap.  The resampling, FFT and
+// code search run on the rsid thread, detections are passed to the main
+// thread together with the trx sample at which the rsid ended.
+//=============================================================================
 void cRsId::receive(const float* buf, size_t len)
 {
+	ENSURE_THREAD(TRX_TID);
 
 	if (len == 0) return;
 
+	rx_samplerate = active_modem->get_samplerate();
+	rx_centerfreq = active_modem->get_freq();
+	rx_reverse = !(wf->Reverse() ^ wf->USB());
+
+	tap.write(buf, len);
+	tap_count += len;
+
+	pthread_mutex_lock(&rx_mutex);
+	pthread_cond_signal(&rx_cond);
+	pthread_mutex_unlock(&rx_mutex);
+}
+
+// rx_flush must be called by the thread that runs the modem, the trx
+// thread calls this before it starts the modem selected by an rsid
+void cRsId::flush_modem()
+{
+	ENSURE_THREAD(TRX_TID);
+
+	if (!flush_request)
+		return;
+	flush_request = false;
+	if (active_modem)
+		active_modem->rx_flush();
+}
+
+void *cRsId::rx_loop(void *arg)
+{
+	SET_THREAD_ID(RSID_TID);
+
+	cRsId *rs = static_cast<cRsId *>(arg);
+	float buf[RSID_TAP_BLOCK];
+	size_t nlost = 0;
+
+	for (;;) {
+		pthread_mutex_lock(&rs->rx_mutex);
+		while (!rs->rx_exit && rs->tapreader.read_space() == 0)
+			pthread_cond_wait(&rs->rx_cond, &rs->rx_mutex);
+		pthread_mutex_unlock(&rs->rx_mutex);
+		if (rs->rx_exit)
+			break;
+
+		size_t n = rs->tapreader.read(buf, RSID_TAP_BLOCK);
+		if (rs->tapreader.lost() != nlost) {
+			LOG_DEBUG("lost %d samples", (int)(rs->tapreader.lost() - nlost));
+			rs->sample_pos += rs->tapreader.lost() - nlost;
+			nlost = rs->tapreader.lost();
+		}
+		rs->process(buf, n);
+	}
+
+	return NULL;
+}
+
+void cRsId::process(const float* buf, size_t len)
+{
 	int srclen = static_cast<int>(len);
-	double src_ratio = RSID_SAMPLE_RATE / active_modem->get_samplerate();
+	double src_ratio = RSID_SAMPLE_RATE / rx_samplerate;
 
 	if (rsid_secondary_time_out > 0) {
 		rsid_secondary_time_out -= (int)(len / src_ratio);
@@ -258,6 +375,7 @@ void cRsId::receive(const float* buf, size_t len)
 		inptr += gend;
 		buf += used;
 		srclen -= used;
+		sample_pos += used;
 
 		while (inptr >= RSID_ARRAY_SIZE) {
 			search();
@@ -275,7 +393,7 @@ void cRsId::search(void)
 		nBinHigh = RSID_FFT_SIZE - 32;
 	}
 	else {
-		float centerfreq = active_modem->get_freq();
+		float centerfreq = rx_centerfreq;
 		float bpf = 1.0 * RSID_ARRAY_SIZE / RSID_SAMPLE_RATE;
 		nBinLow = (int)((centerfreq  - 100.0 * 2) * bpf);
 		nBinHigh = (int)((centerfreq  + 100.0 * 2) * bpf);
@@ -283,7 +401,7 @@ void cRsId::search(void)
 	if (nBinLow < 3) nBinLow = 3;
 	if (nBinHigh > RSID_FFT_SIZE - 32) nBinHigh = RSID_FFT_SIZE - 32;
 
-	bool bReverse = !(wf->Reverse() ^ wf->USB());
+	bool bReverse = rx_reverse;
 	if (bReverse) {
 		nBinLow  = RSID_FFT_SIZE - nBinHigh;
 		nBinHigh = RSID_FFT_SIZE - nBinLow;
@@ -326,6 +444,10 @@ void cRsId::search(void)
 	CalculateBuckets ( aFFTAmpl, bucket_low,  bucket_high - RSID_NTIMES);
 	CalculateBuckets ( aFFTAmpl, bucket_low + 1, bucket_high - RSID_NTIMES);
 
+// trx sample at the end of the fft window
+	unsigned long long sample = sample_pos -
+		(unsigned long long)((inptr - RSID_ARRAY_SIZE) * rx_samplerate / RSID_SAMPLE_RATE);
+
 	int symbol_out_1 = -1;
 	int bin_out_1    = -1;
 	int symbol_out_2 = -1;
@@ -337,7 +459,7 @@ void cRsId::search(void)
 			if (symbol_out_1 != RSID_ESCAPE) {
 				if (bReverse)
 					bin_out_1 = 1024 - bin_out_1 - 31;
-				apply(bin_out_1, symbol_out_1, 0);
+				REQ(rsid_detected, bin_out_1, symbol_out_1, 0, sample);
 				reset();
 				return;
 			} else {
@@ -353,7 +475,7 @@ void cRsId::search(void)
 		if (symbol_out_2 != RSID_NONE2) {
 			if (bReverse)
 				bin_out_2 = 1024 - bin_out_2 - 31;
-			apply(bin_out_2, symbol_out_2, 1);
+			REQ(rsid_detected, bin_out_2, symbol_out_2, 1, sample);
 		}
 		reset();
 	}
@@ -581,9 +703,15 @@ void cRsId::setup_mode(int iSymbol)
 	} // switch (iSymbol)
 }
 
-void cRsId::apply(int iBin, int iSymbol, int extended)
+void rsid_detected(int iBin, int iSymbol, int extended, unsigned long long sample)
 {
-	ENSURE_THREAD(TRX_TID);
+	if (ReedSolomon)
+		ReedSolomon->apply(iBin, iSymbol, extended, sample);
+}
+
+void cRsId::apply(int iBin, int iSymbol, int extended, unsigned long long sample)
+{
+	ENSURE_THREAD(FLMAIN_TID);
 
 	double rsidfreq = 0, currfreq = 0;
 	int n, mbin = NUM_MODES;
@@ -623,8 +751,9 @@ void cRsId::apply(int iBin, int iSymbol, int extended)
 	}
 
 	if (progdefaults.rsid_rx_modes.test(mbin)) {
-		LOG_VERBOSE("RSID: %s @ %0.1f Hz",
-			p_rsid[n].name, rsidfreq);
+		LOG_VERBOSE("RSID: %s @ %0.1f Hz, %0.2f s ago",
+			p_rsid[n].name, rsidfreq,
+			(tap_count - sample) / rx_samplerate);
 	}
 	else {
 		LOG_DEBUG("Ignoring RSID: %s @ %0.1f Hz",
@@ -647,8 +776,9 @@ void cRsId::apply(int iBin, int iSymbol, int extended)
 		REQ(note_qrg, false, "\nBefore RSID: ", "\n",
 			active_modem->get_mode(), 0LL, currfreq);
 
-	if(active_modem) // Currently only effects Olivia, Contestia and MT63.
-		active_modem->rx_flush();
+	// Currently only effects Olivia, Contestia and MT63.
+	// The trx thread flushes the modem before it starts the new one.
+	flush_request = true;
 
 	setup_mode(iSymbol);
 
@@ -672,42 +802,111 @@ inline int cRsId::HammingDistance(int iBucket, unsigned char *p2)
 	return dist;
 }
 
-bool cRsId::search_amp( int &bin_out, int &symbol_out, unsigned char *pcode)
+// search the bins lo .. hi - 1 for the code with the smallest distance,
+// the first code and bin in table order wins a tie
+void cRsId::search_band(rsband &band)
+{
+	int iDistance;
+
+	band.distance = 1000; // infinity
+	band.code = -1;
+	band.bin = -1;
+
+	for (int i = 0; i < band_tblsize; i++) {
+		const unsigned char *pc = band_codes + i * RSID_NSYMBOLS;
+		for (int j = band.lo; j < band.hi; j++) {
+			iDistance = HammingDistance(j, const_cast<unsigned char *>(pc));
+			if (iDistance < band.distance) {
+				band.distance = iDistance;
+				band.code = i;
+				band.bin = j;
+				if (iDistance == 0) break;
+			}
+		}
+	}
+}
+
+void *cRsId::band_loop(void *arg)
 {
-	int i, j;
-	int iDistanceMin = 1000;  // infinity
-	int iDistance    = 1000;
-	int iBin         = -1;
-	int iSymbol      = -1;
+	cRsId *rs = static_cast<cRsId *>(arg);
+	unsigned int gen = 0;
+	int id;
+
+	pthread_mutex_lock(&rs->band_mutex);
+	for (;;) {
+		while (rs->band_gen == gen)
+			pthread_cond_wait(&rs->band_start, &rs->band_mutex);
+		gen = rs->band_gen;
+		if (rs->rx_exit)
+			break;
+		while (rs->bands_next < rs->band_count) {
+			id = rs->bands_next++;
+			pthread_mutex_unlock(&rs->band_mutex);
 
-	int tblsize;
+			rs->search_band(rs->bands[id]);
+
+			pthread_mutex_lock(&rs->band_mutex);
+			if (--rs->bands_pending == 0)
+				pthread_cond_signal(&rs->band_done);
+		}
+	}
+	pthread_mutex_unlock(&rs->band_mutex);
+
+	return NULL;
+}
+
+bool cRsId::search_amp( int &bin_out, int &symbol_out, unsigned char *pcode)
+{
 	const RSIDs *prsid;
 
 	if (pcode == pCodes1) {
-		tblsize = rsid_ids_size1;
+		band_tblsize = rsid_ids_size1;
 		prsid = rsid_ids_1;
 	} else {
-		tblsize = rsid_ids_size2;
+		band_tblsize = rsid_ids_size2;
 		prsid = rsid_ids_2;
 	}
+	band_codes = pcode;
+
+	int lo = nBinLow, hi = nBinHigh - RSID_NTIMES;
+	int n = nbands;
+// the narrow search is not worth waking the other threads
+	if (hi - lo < 64 * n)
+		n = 1;
+	for (int i = 0; i < n; i++) {
+		bands[i].lo = lo + (hi - lo) * i / n;
+		bands[i].hi = lo + (hi - lo) * (i + 1) / n;
+	}
 
-	unsigned char *pc = 0;
-	for (i = 0; i < tblsize; i++) {
-		pc = pcode + i * RSID_NSYMBOLS;
-		for (j = nBinLow; j < nBinHigh - RSID_NTIMES; j++) {
-			iDistance = HammingDistance(j, pc);
-			if (iDistance < iDistanceMin) {
-				iDistanceMin = iDistance;
-				iSymbol  	 = prsid[i].rs;
-				iBin		 = j;
-				if (iDistanceMin == 0) break;
-			}
+	if (n > 1) {
+		pthread_mutex_lock(&band_mutex);
+		band_count = n;
+		bands_next = 1;
+		bands_pending = n - 1;
+		band_gen++;
+		pthread_cond_broadcast(&band_start);
+		pthread_mutex_unlock(&band_mutex);
+	}
+
+	search_band(bands[0]);
+
+	rsband best = bands[0];
+	if (n > 1) {
+		pthread_mutex_lock(&band_mutex);
+		while (bands_pending)
+			pthread_cond_wait(&band_done, &band_mutex);
+		pthread_mutex_unlock(&band_mutex);
+
+		for (int i = 1; i < n; i++) {
+			if (bands[i].distance < best.distance ||
+			    (bands[i].distance == best.distance && bands[i].code < best.code))
+				best = bands[i];
 		}
 	}
 
-	if (iDistanceMin <= hamming_resolution) {
-		symbol_out	= iSymbol;
-		bin_out		= iBin;
+	if (best.distance <= hamming_resolution) {
+		symbol_out	= prsid[best.code].rs;
+		bin_out		= best.bin;
 		return true;
 	}
 
@@ -22,7 +22,13 @@
 
 #include <config.h>
 
+#include <cstdlib>
+#include <cstring>
+#include <cctype>
 #include <list>
+#include <vector>
+#include <string>
+#include <algorithm>
 #include <tr1/unordered_map>
 #include <functional>
 
@@ -62,11 +68,439 @@ struct fre_comp : std::unary_function<const fre_t*, bool>
 typedef list<callback_t*> callback_p_list_t;
 typedef tr1::unordered_map<fre_t*, callback_p_list_t, fre_hash, fre_comp> rcblist_t;
 
-static tr1::unordered_map<int, string> buffers;
+// ----------------------------------------------------------------------------
+// Running every RE over the search buffer after each character is most of the
+// spotter's work.  Most REs can only match if the buffer contains one of a
+// few literal strings ("de", "cq", "qrz", the user's callsign...), and those
+// are found for all REs at once by an Aho-Corasick automaton that advances one
+// state per received character.  An RE is only run when one of its literals
+// lies inside the search window and, if it ends with a character class
+// anchored at the end of the buffer, when the last character is in that class.
+// Both tests are necessary conditions for a match, so the callbacks see the
+// same matches and regexec(3) offsets as before.
+// ----------------------------------------------------------------------------
+
+// the largest literal set that we keep for one RE fragment
+#define MAXLITS 16
+
+typedef vector<string> litset_t;
+
+// What is known about the strings matched by an ERE fragment
+struct refrag_t
+{
+	bool exact;		// every match is one of lits
+	litset_t lits;
+	bool req;		// every match contains one of reqlits
+	litset_t reqlits;
+	litset_t endatoms;	// single character atoms that end every match at $
+	bool end;
+
+	refrag_t() : exact(true), lits(1), req(false), end(false) { }
+};
+
+// Finds literals required by an extended RE.  Anything that is not
+// understood is treated as an unknown atom, which only makes the result
+// less selective.  The literals are folded to ASCII lower case.
+class relit_parser
+{
+public:
+	relit_parser(const char* re, bool icase_) : p(re), icase(icase_), ok(true) { }
+	bool parse(refrag_t& f)
+	{
+		f = alt(0);
+		return ok && *p == '\0';
+	}
+private:
+	const char* p;
+	bool icase;
+	bool ok;
+
+	static bool empty_member(const litset_t& s)
+	{
+		for (size_t i = 0; i < s.size(); i++)
+			if (s[i].empty())
+				return true;
+		return false;
+	}
+	static size_t minlen(const litset_t& s)
+	{
+		size_t n = string::npos;
+		for (size_t i = 0; i < s.size(); i++)
+			n = min(n, s[i].length());
+		return n;
+	}
+	static void unique(litset_t& s)
+	{
+		sort(s.begin(), s.end());
+		s.erase(std::unique(s.begin(), s.end()), s.end());
+	}
+	// keep the set with the longest shortest literal
+	static void candidate(refrag_t& f, const litset_t& s)
+	{
+		if (s.empty() || empty_member(s))
+			return;
+		if (!f.req || minlen(s) > minlen(f.reqlits) ||
+		    (minlen(s) == minlen(f.reqlits) && s.size() < f.reqlits.size())) {
+			f.req = true;
+			f.reqlits = s;
+		}
+	}
+
+	refrag_t alt(int depth)
+	{
+		refrag_t f = concat(depth);
+		while (ok && *p == '|') {
+			p++;
+			refrag_t b = concat(depth);
+			if (f.exact && b.exact && f.lits.size() + b.lits.size() <= MAXLITS) {
+				f.lits.insert(f.lits.end(), b.lits.begin(), b.lits.end());
+				unique(f.lits);
+			}
+			else
+				f.exact = false;
+			if (f.req && b.req && f.reqlits.size() + b.reqlits.size() <= 2 * MAXLITS) {
+				f.reqlits.insert(f.reqlits.end(), b.reqlits.begin(), b.reqlits.end());
+				unique(f.reqlits);
+			}
+			else
+				f.req = false;
+			if (f.end && b.end)
+				f.endatoms.insert(f.endatoms.end(), b.endatoms.begin(), b.endatoms.end());
+			else
+				f.end = false;
+		}
+		return f;
+	}
+
+	refrag_t concat(int depth)
+	{
+		refrag_t f;
+		litset_t cur(1);
+		string lastsrc;	// the previous atom, if it matches one character
+
+		while (ok && *p && *p != '|' && *p != ')') {
+			const char* start = p;
+			bool exact = false, single = false, anchor = false;
+			litset_t set;
+			refrag_t sub;
+
+			switch (*p) {
+			case '(':
+				p++;
+				sub = alt(depth + 1);
+				if (*p != ')') {
+					ok = false;
+					return f;
+				}
+				p++;
+				exact = sub.exact;
+				set = sub.lits;
+				break;
+			case '[':
+				if (!bracket())
+					return f;
+				single = true;
+				break;
+			case '.':
+				p++;
+				single = true;
+				break;
+			case '^': case '$':
+				p++;
+				anchor = true;
+				break;
+			case '*': case '+': case '?': case '{':
+				ok = false;
+				return f;
+			case '\\':
+				if (!*++p) {
+					ok = false;
+					return f;
+				}
+				// only escaped ERE operators are literals; back
+				// references and GNU operators such as \< \> \b \w
+				// are zero-width or unknown atoms that end the run
+				if (!strchr(".[]()*+?{}|^$\\", *p)) {
+					p++;
+					break;
+				}
+				// fall through
+			default:
+				{
+					unsigned char c = *p++;
+					if (c >= 'A' && c <= 'Z')
+						c += 'a' - 'A';
+					single = true;
+					// non ASCII characters, and those with case
+					// variants outside ASCII in some locales
+					if (c >= 0x80 || (icase && (c == 'i' || c == 'k')))
+						break;
+					exact = true;
+					set.push_back(string(1, c));
+				}
+			}
+			string src(start, p);
+
+			bool optional = false, repeat = false;
+			while (*p == '*' || *p == '+' || *p == '?' || *p == '{') {
+				repeat = true;
+				if (*p == '{') {
+					const char* q = ++p;
+					while (isdigit((unsigned char)*p))
+						p++;
+					if (p == q || strtol(q, NULL, 10) == 0)
+						optional = true;
+					while (*p && *p != '}')
+						p++;
+					if (*p != '}') {
+						ok = false;
+						return f;
+					}
+				}
+				else if (*p != '+')
+					optional = true;
+				p++;
+			}
+
+			if (anchor && *start == '$' && !repeat && !lastsrc.empty()) {
+				f.end = true;
+				f.endatoms.assign(1, lastsrc);
+			}
+			else
+				f.end = false;
+			lastsrc = (single && !optional) ? src : "";
+
+			if (optional) {
+				candidate(f, cur);
+				cur.assign(1, "");
+				f.exact = false;
+			}
+			else if (exact) {
+				litset_t x;
+				for (size_t i = 0; i < cur.size() && x.size() <= MAXLITS; i++)
+					for (size_t j = 0; j < set.size(); j++)
+						x.push_back(cur[i] + set[j]);
+				if (x.size() > MAXLITS) {
+					candidate(f, cur);
+					f.exact = false;
+					x = set;
+				}
+				unique(x);
+				cur = x;
+				if (repeat) {
+					candidate(f, cur);
+					cur.assign(1, "");
+					f.exact = false;
+				}
+			}
+			else {
+				candidate(f, cur);
+				cur.assign(1, "");
+				f.exact = false;
+				if (sub.req)
+					candidate(f, sub.reqlits);
+			}
+		}
+
+		candidate(f, cur);
+		if (f.exact)
+			f.lits = cur;
+		if (depth > 0)
+			f.end = false;
+		return f;
+	}
+
+	bool bracket(void)
+	{
+		p++;
+		if (*p == '^')
+			p++;
+		if (*p == ']')
+			p++;
+		while (*p && *p != ']') {
+			if (*p == '[' && (p[1] == ':' || p[1] == '.' || p[1] == '=')) {
+				char d = p[1];
+				p += 2;
+				while (*p && !(*p == d && p[1] == ']'))
+					p++;
+				if (!*p)
+					break;
+				p += 2;
+			}
+			else
+				p++;
+		}
+		if (*p != ']')
+			return ok = false;
+		p++;
+		return true;
+	}
+};
+
+// One registered RE and its prefilter
+struct rentry_t
+{
+	rcblist_t::value_type* rcb;
+	vector<int> lits;	// literal ids, empty if the RE is always run
+	bool has_endset;
+	bool endset[256];
+};
+
+// The Aho-Corasick automaton for the literals of all REs
+struct prefilter_t
+{
+	vector<string> lits;
+	vector<int> delta;		// states * 256 transitions
+	vector<vector<int> > out;	// literals that end in each state
+	vector<rentry_t> entries;
+	unsigned char fold[256];
+};
+
+// A decoder's search buffer and automaton state
+struct decbuf_t
+{
+	string buf;
+	int state;
+	unsigned long count;		// characters received
+	unsigned long nul;		// position after the last NUL
+	vector<unsigned long> seen;	// end position of each literal, 0 if not seen
+
+	decbuf_t() : state(0), count(0), nul(0) { }
+};
+
+static tr1::unordered_map<int, decbuf_t> buffers;
 static cblist_t cblist;
 static rcblist_t rcblist;
+static prefilter_t prefilter;
+
+static inline void prefilter_feed(decbuf_t& d, unsigned char c)
+{
+	d.count++;
+	if (unlikely(c == '\0'))
+		d.nul = d.count;
+	d.state = prefilter.delta[d.state * 256 + prefilter.fold[c]];
+	const vector<int>& o = prefilter.out[d.state];
+	for (size_t i = 0; i < o.size(); i++)
+		d.seen[o[i]] = d.count;
+}
+
+static void prefilter_entry(rentry_t& e, const fre_t& re, tr1::unordered_map<string, int>& litid)
+{
+	e.lits.clear();
+	e.has_endset = false;
+	if (!re || !(re.cf() & REG_EXTENDED))
+		return;
+
+	refrag_t f;
+	relit_parser parser(re.re().c_str(), re.cf() & REG_ICASE);
+	if (!parser.parse(f))
+		return;
+
+	if (f.req) {
+		for (size_t i = 0; i < f.reqlits.size(); i++) {
+			tr1::unordered_map<string, int>::iterator j = litid.find(f.reqlits[i]);
+			if (j == litid.end()) {
+				j = litid.insert(make_pair(f.reqlits[i], (int)prefilter.lits.size())).first;
+				prefilter.lits.push_back(f.reqlits[i]);
+			}
+			e.lits.push_back(j->second);
+		}
+	}
 
-void spot_recv(char c, int decoder, int afreq, int md)
+	// $ also matches before a newline with REG_NEWLINE
+	if (!f.end || (re.cf() & REG_NEWLINE))
+		return;
+	memset(e.endset, 0, sizeof(e.endset));
+	for (size_t i = 0; i < f.endatoms.size(); i++) {
+		regex_t preg;
+		string atom = "^" + f.endatoms[i] + "$";
+		if (regcomp(&preg, atom.c_str(), (re.cf() & ~REG_NEWLINE) | REG_NOSUB))
+			return;
+		for (int c = 1; c < 256; c++) {
+			char str[2] = { (char)c, '\0' };
+			if (!regexec(&preg, str, 0, NULL, 0))
+				e.endset[c] = true;
+		}
+		regfree(&preg);
+	}
+	e.has_endset = true;
+}
+
+// Called whenever an RE is added or removed
+static void prefilter_build(void)
+{
+	prefilter.lits.clear();
+	prefilter.entries.clear();
+	for (int c = 0; c < 256; c++)
+		prefilter.fold[c] = (c >= 'A' && c <= 'Z') ? c + 'a' - 'A' : c;
+
+	tr1::unordered_map<string, int> litid;
+	for (rcblist_t::iterator i = rcblist.begin(); i != rcblist.end(); ++i) {
+		rentry_t e;
+		e.rcb = &*i;
+		prefilter_entry(e, *i->first, litid);
+		prefilter.entries.push_back(e);
+	}
+
+	// the trie, with -1 for missing transitions
+	vector<int>& delta = prefilter.delta;
+	vector<vector<int> >& out = prefilter.out;
+	delta.assign(256, -1);
+	out.assign(1, vector<int>());
+	for (size_t i = 0; i < prefilter.lits.size(); i++) {
+		const string& l = prefilter.lits[i];
+		int s = 0;
+		for (size_t j = 0; j < l.length(); j++) {
+			int& t = delta[s * 256 + (unsigned char)l[j]];
+			if (t == -1) {
+				t = out.size();
+				delta.resize(delta.size() + 256, -1);
+				out.push_back(vector<int>());
+			}
+			s = delta[s * 256 + (unsigned char)l[j]];
+		}
+		out[s].push_back(i);
+	}
+
+	// breadth first, turn the failure links into transitions
+	vector<int> fail(out.size(), 0), queue;
+	for (int c = 0; c < 256; c++) {
+		int& t = delta[c];
+		if (t == -1)
+			t = 0;
+		else
+			queue.push_back(t);
+	}
+	for (size_t q = 0; q < queue.size(); q++) {
+		int s = queue[q];
+		const vector<int>& fo = out[fail[s]];
+		out[s].insert(out[s].end(), fo.begin(), fo.end());
+		for (int c = 0; c < 256; c++) {
+			int& t = delta[s * 256 + c];
+			if (t == -1)
+				t = delta[fail[s] * 256 + c];
+			else {
+				fail[t] = delta[fail[s] * 256 + c];
+				queue.push_back(t);
+			}
+		}
+	}
+
+	// replay the buffers through the new automaton
+	for (tr1::unordered_map<int, decbuf_t>::iterator i = buffers.begin(); i != buffers.end(); ++i) {
+		decbuf_t& d = i->second;
+		d.state = 0;
+		d.seen.assign(prefilter.lits.size(), 0);
+		unsigned long count = d.count, nul = d.nul;
+		d.count -= d.buf.length();
+		for (size_t j = 0; j < d.buf.length(); j++)
+			prefilter_feed(d, d.buf[j]);
+		d.count = count;
+		d.nul = nul;
+	}
+}
+
+void spot_recv(char c, int decoder, int afreq, int md, spot_flush_t flush)
 {
 	static trx_mode last_mode = NUM_MODES + 1;
 
@@ -83,21 +517,47 @@ void spot_recv(char c, int decoder, int afreq, int md)
 	if (afreq == 0)
 		afreq = active_modem->get_freq();
 
-	string& buf = buffers[decoder];
-	if (unlikely(buf.capacity() < DECBUFSIZE))
+	if (unlikely(prefilter.delta.empty()))
+		prefilter_build();
+
+	decbuf_t& d = buffers[decoder];
+	string& buf = d.buf;
+	if (unlikely(buf.capacity() < DECBUFSIZE)) {
 		buf.reserve(DECBUFSIZE);
+		d.seen.assign(prefilter.lits.size(), 0);
+	}
 
 	buf += c;
-	string::size_type n = buf.length();
-	if (n == DECBUFSIZE)
+	prefilter_feed(d, c);
+	if (buf.length() == DECBUFSIZE)
 		buf.erase(0, DECBUFSIZE - SEARCHLEN);
+	string::size_type n = buf.length();
 	const char* search = buf.c_str() + (n > SEARCHLEN ? n - SEARCHLEN : 0);
 
-	for (rcblist_t::iterator i = rcblist.begin(); i != rcblist.end(); ++i) {
+	// the window starts here, and ends with c unless it holds a NUL
+	unsigned long wstart = d.count - (n > SEARCHLEN ? SEARCHLEN : n);
+	bool endc = d.nul <= wstart;
+
+	for (vector<rentry_t>::iterator e = prefilter.entries.begin(); e != prefilter.entries.end(); ++e) {
+		if (e->has_endset && endc && !e->endset[(unsigned char)c])
+			continue;
+		if (!e->lits.empty()) {
+			vector<int>::const_iterator l;
+			for (l = e->lits.begin(); l != e->lits.end(); ++l)
+				if (d.seen[*l] && d.seen[*l] - prefilter.lits[*l].length() >= wstart)
+					break;
+			if (l == e->lits.end())
+				continue;
+		}
+		rcblist_t::value_type* i = e->rcb;
 		if (unlikely(i->first->match(search))) {
 			const vector<regmatch_t>& m = i->first->suboff();
 			for (list<callback_t*>::iterator j = i->second.begin();
 			     j != i->second.end() && (*j)->rcb; ++j) {
+				if (flush) {
+					flush();
+					flush = NULL;
+				}
 				if (m.empty())
 					(*j)->rcb(last_mode, afreq, search, NULL, 0, (*j)->data);
 				else
@@ -179,8 +639,10 @@ void spot_register_recv(spot_recv_cb_t rcb, void* rdata, const char* re, int ref
 		i->second.push_back(&cblist.back());
 		delete fre;
 	}
-	else
+	else {
 		rcblist[fre].push_back(&cblist.back());
+		prefilter_build();
+	}
 	show_spot(true);
 }
 
@@ -231,6 +693,7 @@ void spot_unregister_recv(spot_recv_cb_t rcb, const void* rdata)
 	}
 
 out:
+	prefilter_build();
 	for (i = cblist.begin(); i != cblist.end(); ++i)
 		if (i->rcb) break;
 	show_spot(i != cblist.end());
@@ -16,6 +16,11 @@
 /* For online() getter */
 #include "dl_fldigi/dl_fldigi.h"
 
+/* For the worker thread and posting updates to the main thread */
+#include "threads.h"
+#include "qrunner.h"
+#include "debug.h"
+
 /* Used for passing curl data to post thread */
 typedef struct {
 	CURL *curl;
@@ -141,20 +146,81 @@ ssdv_error_exit (j_common_ptr cinfo)
 #define WIN_MAX_WIDTH (800)
 #define WIN_MAX_HEIGHT (600 + UI_HEIGHT)
 
+/**** PACKET SYNC ****/
+
+/* The SSDV CRC covers bytes 1 to SSDV_PKT_SIZE_CRCDATA of the packet.
+ * ssdv_dec_is_packet() forces byte 1 to 0x66, so only the bytes after it
+ * are rolled through the CRC as the window slides. */
+#define SYNC_CRC_START (2)
+#define SYNC_CRC_LEN   (SSDV_PKT_SIZE_CRCDATA - 1)
+#define SYNC_CRC_END   (SYNC_CRC_START + SYNC_CRC_LEN)
+
+static uint32_t crc_step_table[256];
+static uint32_t crc_drop_table[256];
+static uint32_t crc_offset;
+static bool crc_tables_init = false;
+
+static inline uint32_t crc_step(uint32_t crc, uint8_t byte)
+{
+	return (crc >> 8) ^ crc_step_table[(crc ^ byte) & 0xFF];
+}
+
+static void init_crc_tables()
+{
+	uint32_t x;
+	int i, j;
+	
+	if(crc_tables_init) return;
+	
+	for(i = 0; i < 256; i++)
+	{
+		x = i;
+		for(j = 8; j > 0; j--)
+		{
+			if(x & 1) x = (x >> 1) ^ 0xEDB88320;
+			else x >>= 1;
+		}
+		crc_step_table[i] = x;
+	}
+	
+	/* Contribution of a byte once it is SYNC_CRC_LEN bytes old, so
+	 * it can be removed from the rolling CRC as it leaves the window */
+	for(i = 0; i < 256; i++)
+	{
+		x = crc_step(0, i);
+		for(j = 0; j < SYNC_CRC_LEN; j++) x = crc_step(x, 0);
+		crc_drop_table[i] = x;
+	}
+	
+	/* The CRC is affine: the initial value, the forced 0x66 and the
+	 * final XOR add a constant to the zero-initialised rolling CRC */
+	x = crc_step(0xFFFFFFFF, 0x66);
+	for(j = 0; j < SYNC_CRC_LEN; j++) x = crc_step(x, 0);
+	crc_offset = x ^ 0xFFFFFFFF;
+	
+	crc_tables_init = true;
+}
+
 ssdv_rx::ssdv_rx(int w, int h, const char *title)
 	: Fl_Double_Window(w, h, title)
 {
 	buffer = new uint8_t[BUFFER_SIZE];
 	erasures = new uint8_t[BUFFER_SIZE];
 	
+	init_crc_tables();
+	
 	/* Empty receive buffer */
 	clear_buffer();
+	pkt_bytes = -1;
 	
 	/* No image yet */
 	packets = NULL;
+	work_image = NULL;
 	image = NULL;
 	flrgb = NULL;
 	image_id = -1;
+	display_width = 0;
+	display_height = 0;
 	
 	begin();
 	
@@ -234,14 +300,45 @@ ssdv_rx::ssdv_rx(int w, int h, const char *title)
 	
 	size_range(WIN_MIN_WIDTH, WIN_MIN_HEIGHT, 0, 0, 0, 0, 0);
 	resizable(scroll);
+	
+	/* Start the decoder */
+	rxq = new ringbuffer<rx_byte>(RXQ_SIZE);
+	rxq_lost = 0;
+	rx_exit = false;
+	rx_busy = false;
+	pthread_mutex_init(&rx_mutex, NULL);
+	pthread_cond_init(&rx_cond, NULL);
+	pthread_cond_init(&rx_idle, NULL);
+	if(pthread_create(&rx_thread, NULL, rx_loop, this) != 0)
+	{
+		LOG_PERROR("pthread_create");
+		abort();
+	}
 }
 
 ssdv_rx::~ssdv_rx()
 {
+	pthread_mutex_lock(&rx_mutex);
+	rx_exit = true;
+	pthread_cond_signal(&rx_cond);
+	pthread_mutex_unlock(&rx_mutex);
+	pthread_join(rx_thread, NULL);
+	
+	/* Run the updates still queued for the main thread, which only free
+	 * themselves now that rx_exit is set */
+	REQ_FLUSH(SSDV_TID);
+	
+	pthread_cond_destroy(&rx_idle);
+	pthread_cond_destroy(&rx_cond);
+	pthread_mutex_destroy(&rx_mutex);
+	delete rxq;
+	
 	if(flrgb) delete flrgb;
-	if(image) delete image;
-	if(buffer) delete buffer;
-	if(erasures) delete erasures;
+	if(image) delete [] image;
+	if(work_image) delete [] work_image;
+	if(packets) free(packets);
+	if(buffer) delete [] buffer;
+	if(erasures) delete [] erasures;
 }
 
 void ssdv_rx::feed_buffer(uint8_t byte, uint8_t erasure)
@@ -258,12 +355,69 @@ void ssdv_rx::feed_buffer(uint8_t byte, uint8_t erasure)
 	
 	if(bl < SSDV_PKT_SIZE) bl++;
 	else if(++bc == SSDV_PKT_SIZE) bc = 0;
+	
+	if(bl == SSDV_PKT_SIZE) update_sync_crc();
 }
 
 void ssdv_rx::clear_buffer()
 {
 	bc = 0;
 	bl = 0;
+	sync_crc_valid = false;
+}
+
+/* Keep the CRC of the current window up to date in O(1) per byte */
+void ssdv_rx::update_sync_crc()
+{
+	uint8_t *b = &buffer[bc];
+	int i;
+	
+	if(!sync_crc_valid)
+	{
+		/* The window has just filled, calculate it in full */
+		sync_crc = 0;
+		for(i = SYNC_CRC_START; i < SYNC_CRC_END; i++)
+			sync_crc = crc_step(sync_crc, b[i]);
+		sync_crc_valid = true;
+		return;
+	}
+	
+	/* The window moved by one byte: b[SYNC_CRC_START - 1] has just
+	 * left the CRC range and b[SYNC_CRC_END - 1] has just entered it */
+	sync_crc = crc_step(sync_crc, b[SYNC_CRC_END - 1]) ^
+		crc_drop_table[b[SYNC_CRC_START - 1]];
+}
+
+/* Cheap tests run on every byte before the full reed-solomon decode.
+ * A packet is only a candidate if its CRC already matches, or if either
+ * of the sync and packet type bytes are intact or erased. With both of
+ * them corrupted, the window is still tried where the next packet of a
+ * back to back stream is expected, or when most of the callsign and
+ * image ID bytes are those of the last packet. So only the first packet
+ * of an image, or after a gap, must have a sync byte to be decoded. */
+bool ssdv_rx::is_sync_candidate()
+{
+	uint8_t *b = &buffer[bc];
+	uint8_t *e = &erasures[bc];
+	uint32_t x;
+	int i, n;
+	
+	if(b[0] == 0x55 || e[0] || b[1] == 0x66 || e[1]) return true;
+	
+	if(pkt_bytes >= 0)
+	{
+		if(pkt_bytes > 0 && pkt_bytes % SSDV_PKT_SIZE == 0) return true;
+		
+		for(i = n = 0; i < 5; i++)
+			if(b[2 + i] == pkt_header[i] || e[2 + i]) n++;
+		if(n >= 3) return true;
+	}
+	
+	x = sync_crc ^ crc_offset;
+	return(b[SYNC_CRC_END + 0] == ((x >> 24) & 0xFF) &&
+	       b[SYNC_CRC_END + 1] == ((x >> 16) & 0xFF) &&
+	       b[SYNC_CRC_END + 2] == ((x >> 8) & 0xFF) &&
+	       b[SYNC_CRC_END + 3] == (x & 0xFF));
 }
 
 static void *upload_packet_thread(void *arg)
@@ -382,7 +536,93 @@ void ssdv_rx::upload_packet(int fixes)
 	return;
 }
 
+/**** DECODER THREAD ****/
+
+/* What the main thread needs to show a decoded packet */
+struct ssdv_rx::update
+{
+	/* A new image was started, the display is resized */
+	bool new_image;
+	int width;
+	int height;
+	
+	/* Rows y0 to y1 - 1 of the image were rendered, a copy of them */
+	int y0;
+	int y1;
+	uint8_t *rows;
+	
+	char msg[200];
+	char callsign[16];
+	char received[16];
+	char imageid[16];
+	char missing[16];
+	char fixes[16];
+	char size[16];
+	int mcu_count;
+	int mcu_id;
+};
+
+/* Called by the modem for every received byte, with the number of bytes
+ * lost before it. The byte is queued for the decoder thread. */
 void ssdv_rx::put_byte(uint8_t byte, int lost)
+{
+	rx_byte b;
+	
+	b.byte = byte;
+	b.lost = lost + rxq_lost;
+	
+	/* If the decoder is behind, the byte is counted as lost */
+	if(rxq->write(&b, 1) == 0)
+	{
+		rxq_lost += lost + 1;
+		return;
+	}
+	rxq_lost = 0;
+	
+	pthread_mutex_lock(&rx_mutex);
+	pthread_cond_signal(&rx_cond);
+	pthread_mutex_unlock(&rx_mutex);
+}
+
+/* Wait until the decoder thread has processed every byte queued so far.
+ * Used by the benchmark replay, the modems never wait for the decoder. */
+void ssdv_rx::wait_idle()
+{
+	pthread_mutex_lock(&rx_mutex);
+	while(!rx_exit && (rx_busy || rxq->read_space() > 0))
+		pthread_cond_wait(&rx_idle, &rx_mutex);
+	pthread_mutex_unlock(&rx_mutex);
+}
+
+void *ssdv_rx::rx_loop(void *arg)
+{
+	SET_THREAD_ID(SSDV_TID);
+	
+	ssdv_rx *rx = static_cast<ssdv_rx *>(arg);
+	rx_byte buf[256];
+	size_t i, n;
+	
+	for(;;)
+	{
+		pthread_mutex_lock(&rx->rx_mutex);
+		rx->rx_busy = false;
+		if(rx->rxq->read_space() == 0)
+			pthread_cond_broadcast(&rx->rx_idle);
+		while(!rx->rx_exit && rx->rxq->read_space() == 0)
+			pthread_cond_wait(&rx->rx_cond, &rx->rx_mutex);
+		rx->rx_busy = true;
+		pthread_mutex_unlock(&rx->rx_mutex);
+		if(rx->rx_exit) break;
+		
+		n = rx->rxq->read(buf, sizeof(buf) / sizeof(buf[0]));
+		for(i = 0; i < n; i++)
+			rx->process_byte(buf[i].byte, buf[i].lost);
+	}
+	
+	return NULL;
+}
+
+void ssdv_rx::process_byte(uint8_t byte, int lost)
 {
 	int i;
 	
@@ -395,13 +635,19 @@ void ssdv_rx::put_byte(uint8_t byte, int lost)
 	
 	/* Feed the byte into the buffer */
 	feed_buffer(byte, 0);
+	if(pkt_bytes >= 0) pkt_bytes += lost + 1;
 	
 	/* Enough data yet to form a packet? */
 	if(bl < SSDV_PKT_SIZE) return;
 	
+	/* Skip the reed-solomon decoder unless this could be a packet */
+	if(!is_sync_candidate()) return;
+	
 	/* Test if this is a packet and is valid */
 	uint8_t *b = &buffer[bc];
 	if(ssdv_dec_is_packet(b, &i, &erasures[bc]) != 0) return;
+	pkt_bytes = 0;
+	memcpy(pkt_header, b + 2, sizeof(pkt_header));
 	
 	/* Make a note of the number of errors */
 	image_errors += i;
@@ -412,6 +658,9 @@ void ssdv_rx::put_byte(uint8_t byte, int lost)
 	/* Read the header */
 	ssdv_dec_header(&pkt_info, b);
 	
+	update *u = new update;
+	u->new_image = false;
+	
 	/* Does this belong to the same image? */
 	if(pkt_info.callsign != image_callsign ||
 	   pkt_info.image_id != image_id ||
@@ -430,27 +679,18 @@ void ssdv_rx::put_byte(uint8_t byte, int lost)
 		image_errors         = i;
 		
 		/* Initialise and clear the image buffer */
-		if(image) delete image;
-		image_len = image_width * image_height * 3;
-		image = new unsigned char[image_len];
-		
-		/* Create the Fl_RGB_Image object */
-		if(flrgb) delete flrgb;
-		flrgb = new Fl_RGB_Image(image, image_width, image_height, 3);
-		box->size(image_width, image_height);
-		box->image(flrgb);
-		
-		/* Snap the window to the new image size */
-		size(
-			CLAMP(image_width, WIN_MIN_WIDTH, WIN_MAX_WIDTH),
-			CLAMP(image_height + UI_HEIGHT, WIN_MIN_HEIGHT, WIN_MAX_HEIGHT)
-		);
+		if(work_image) delete [] work_image;
+		work_image = new uint8_t[image_width * image_height * 3];
+		memset(work_image, 0, image_width * image_height * 3);
+		u->new_image = true;
 		
 		/* Clear the packet buffer */
 		if(packets != NULL) free(packets);
 		packets = NULL;
 		packets_len = 0;
 	}
+	u->width = image_width;
+	u->height = image_height;
 	
 	/* Realloc packet buffer for new packet */
 	if(pkt_info.packet_id + 1 > packets_len)
@@ -461,6 +701,7 @@ void ssdv_rx::put_byte(uint8_t byte, int lost)
 		{
 			fprintf(stderr, "Error reallocating memory\n");
 			perror("realloc");
+			delete u;
 			return;
 		}
 		
@@ -478,28 +719,14 @@ void ssdv_rx::put_byte(uint8_t byte, int lost)
 	/* Done with the receive buffer */
 	clear_buffer();	
 	
-	/* Display a message on the fldigi interface */
-	put_status("SSDV: Decoded image packet!", 10);
-	
-	char msg[200], callsign[10];
-	snprintf(msg, 200, "Decoded image packet. Callsign: %s, Image ID: %02X, Resolution: %dx%d, Packet ID: %d",
+	char callsign[10];
+	snprintf(u->msg, sizeof(u->msg), "Decoded image packet. Callsign: %s, Image ID: %02X, Resolution: %dx%d, Packet ID: %d",
 		ssdv_decode_callsign(callsign, pkt_info.callsign),
 		pkt_info.image_id,
 		pkt_info.width,
 		pkt_info.height,
 		pkt_info.packet_id);
 	
-	if(bHAB)
-	{
-		habString->value(msg);
-		habString->color(FL_GREEN);
-		habString->damage(FL_DAMAGE_ALL);
-	}
-	
-	ReceiveText->addstr("\n");
-	ReceiveText->addstr(msg, FTextBase::QSY);
-	ReceiveText->addstr("\n");
-	
 	/* Initialise the decoder */
 	ssdv_t dec;
 	ssdv_dec_init(&dec);
@@ -516,7 +743,8 @@ void ssdv_rx::put_byte(uint8_t byte, int lost)
 	}
 	
 	/* Store the last decoded MCU, for the progress bar */
-	int mcu_id = dec.mcu_id;
+	u->mcu_id = dec.mcu_id;
+	u->mcu_count = dec.mcu_count;
 	
 	/* Get the final image */
 	uint8_t *jpeg;
@@ -527,36 +755,114 @@ void ssdv_rx::put_byte(uint8_t byte, int lost)
 	/* Save the image to disk */
 	save_image(jpeg, length);
 	
-	/* Render the image to screen */
-	render_image(jpeg, length);
-	flrgb->uncache();
-	box->redraw();
+	/* Render only the band of the image changed by this packet, and pass
+	 * a copy of it to the main thread */
+	int mcu_start, mcu_end, y0, y1;
+	packet_mcu_range(pkt_info.packet_id, dec.mcu_count, &mcu_start, &mcu_end);
+	
+	u->y0 = u->y1 = 0;
+	u->rows = NULL;
+	if(render_image(jpeg, length, mcu_start, mcu_end, &y0, &y1) && y1 > y0)
+	{
+		size_t row_stride = image_width * 3;
+		u->y0 = y0;
+		u->y1 = y1;
+		u->rows = new uint8_t[(y1 - y0) * row_stride];
+		memcpy(u->rows, work_image + y0 * row_stride, (y1 - y0) * row_stride);
+	}
 	
 	free(jpeg);
 	
-	/* Update values on display */
-	char s[16];
+	/* Values for the display */
+	ssdv_decode_callsign(u->callsign, image_callsign);
+	snprintf(u->received, 16, "%d", image_received_packets);
+	snprintf(u->imageid, 16, "0x%02X", pkt_info.image_id);
+	snprintf(u->missing, 16, "%d", image_lost_packets);
+	snprintf(u->fixes, 16, "%d byte%s", image_errors, (image_errors == 1 ? "" : "s"));
+	snprintf(u->size, 16, "%ix%i", image_width, image_height);
 	
-	ssdv_decode_callsign(s, image_callsign);
-	flcallsign->copy_label(s);
+	/* The update is dropped if the main thread queue is full */
+	if(!cbq[SSDV_TID]->request(qrbind::bind(&ssdv_rx::show_update, this, u)))
+	{
+		delete [] u->rows;
+		delete u;
+	}
+}
+
+/* Show a decoded packet, runs on the main thread */
+void ssdv_rx::show_update(update *u)
+{
+	ENSURE_THREAD(FLMAIN_TID);
 	
-	snprintf(s, 16, "%d", image_received_packets);
-	flreceived->copy_label(s);
+	/* Left in the queue when the window was closed */
+	if(rx_exit)
+	{
+		delete [] u->rows;
+		delete u;
+		return;
+	}
 	
-	snprintf(s, 16, "0x%02X", pkt_info.image_id);
-	flimageid->copy_label(s);
+	if(u->new_image || !image ||
+	   u->width != display_width || u->height != display_height)
+	{
+		display_width = u->width;
+		display_height = u->height;
+		
+		/* Initialise and clear the image buffer */
+		if(image) delete [] image;
+		image_len = display_width * display_height * 3;
+		image = new uint8_t[image_len];
+		memset(image, 0, image_len);
+		
+		/* Create the Fl_RGB_Image object */
+		if(flrgb) delete flrgb;
+		flrgb = new Fl_RGB_Image(image, display_width, display_height, 3);
+		box->size(display_width, display_height);
+		box->image(flrgb);
+		
+		/* Snap the window to the new image size */
+		size(
+			CLAMP(display_width, WIN_MIN_WIDTH, WIN_MAX_WIDTH),
+			CLAMP(display_height + UI_HEIGHT, WIN_MIN_HEIGHT, WIN_MAX_HEIGHT)
+		);
+	}
 	
-	snprintf(s, 16, "%d", image_lost_packets);
-	flmissing->copy_label(s);
+	/* Display a message on the fldigi interface */
+	put_status("SSDV: Decoded image packet!", 10);
 	
-	snprintf(s, 16, "%d byte%s", image_errors, (image_errors == 1 ? "" : "s"));
-	flfixes->copy_label(s);
+	if(bHAB)
+	{
+		habString->value(u->msg);
+		habString->color(FL_GREEN);
+		habString->damage(FL_DAMAGE_ALL);
+	}
+	
+	ReceiveText->addstr("\n");
+	ReceiveText->addstr(u->msg, FTextBase::QSY);
+	ReceiveText->addstr("\n");
+	
+	/* Copy in the rows that changed */
+	if(u->rows)
+	{
+		size_t row_stride = display_width * 3;
+		memcpy(image + u->y0 * row_stride, u->rows, (u->y1 - u->y0) * row_stride);
+		flrgb->uncache();
+		box->damage(FL_DAMAGE_ALL, box->x(), box->y() + u->y0, display_width, u->y1 - u->y0);
+		delete [] u->rows;
+	}
+	
+	/* Update values on display */
+	flcallsign->copy_label(u->callsign);
+	flreceived->copy_label(u->received);
+	flimageid->copy_label(u->imageid);
+	flmissing->copy_label(u->missing);
+	flfixes->copy_label(u->fixes);
+	flsize->copy_label(u->size);
 	
-	snprintf(s, 16, "%ix%i", image_width, image_height);
-	flsize->copy_label(s);
+	flprogress->maximum(u->mcu_count);
+	flprogress->value(u->mcu_id);
 	
-	flprogress->maximum(dec.mcu_count);
-	flprogress->value(mcu_id);
+	delete u;
 }
 
 void ssdv_rx::save_image(uint8_t *jpeg, size_t length)
@@ -609,7 +915,43 @@ void ssdv_rx::save_image(uint8_t *jpeg, size_t length)
 	/* Job done */
 }
 
-void ssdv_rx::render_image(uint8_t *jpeg, size_t length)
+/* Find the MCUs that can change when packet_id is added to the image.
+ * Each packet with a new MCU resets the DC values, so the change is
+ * limited to the span between the nearest received packets either side,
+ * which covers MCUs straddling the packet boundaries and any gap fill. */
+void ssdv_rx::packet_mcu_range(int packet_id, int mcu_count, int *mcu_start, int *mcu_end)
+{
+	uint8_t *p;
+	int i;
+	
+	*mcu_start = 0;
+	*mcu_end = mcu_count;
+	
+	for(i = packet_id - 1; i >= 0; i--)
+	{
+		p = packets + (i * SSDV_PKT_SIZE);
+		if(p[0] != 0x55 || p[12] == 0xFF) continue;
+		*mcu_start = (p[13] << 8) | p[14];
+		break;
+	}
+	
+	for(i = packet_id + 1; i < packets_len; i++)
+	{
+		p = packets + (i * SSDV_PKT_SIZE);
+		if(p[0] != 0x55 || p[12] == 0xFF) continue;
+		*mcu_end = (p[13] << 8) | p[14];
+		break;
+	}
+	
+	if(*mcu_end > mcu_count) *mcu_end = mcu_count;
+	if(*mcu_start >= *mcu_end) *mcu_start = 0;
+}
+
+/* Decode the rows of the image covering MCUs mcu_start to mcu_end - 1,
+ * and the row on either side of them. Rows above the band are skipped
+ * without the IDCT where libjpeg allows it, and decoding stops at the end
+ * of the band. The rows updated are returned in y0 and y1. */
+bool ssdv_rx::render_image(uint8_t *jpeg, size_t length, int mcu_start, int mcu_end, int *y0, int *y1)
 {
 	int r;
 	struct jpeg_decompress_struct cinfo;
@@ -622,7 +964,7 @@ void ssdv_rx::render_image(uint8_t *jpeg, size_t length)
 	{
 		/* JPEG decoding failed */
 		jpeg_destroy_decompress(&cinfo);
-		return;
+		return(false);
 	}
 	
 	jpeg_create_decompress(&cinfo);
@@ -632,10 +974,11 @@ void ssdv_rx::render_image(uint8_t *jpeg, size_t length)
 	if(r != JPEG_HEADER_OK)
 	{
 		jpeg_destroy_decompress(&cinfo);
-		return;
+		return(false);
 	}
 	
-	int row_stride;
+	int row_stride, mcu_width, mcu_height, mcus_per_row;
+	JDIMENSION top, bottom;
 	
 	/* Force RGB output and use floating point DCT */
 	cinfo.out_color_space = JCS_RGB;
@@ -644,22 +987,59 @@ void ssdv_rx::render_image(uint8_t *jpeg, size_t length)
 	jpeg_start_decompress(&cinfo);
 	
 	/* Fail if the image doesn't match our requirements */
-	if(cinfo.output_components != 3)
+	if(cinfo.output_components != 3 ||
+	   (int) cinfo.output_width != image_width ||
+	   (int) cinfo.output_height != image_height)
 	{
-		jpeg_finish_decompress(&cinfo);
+		jpeg_abort_decompress(&cinfo);
 		jpeg_destroy_decompress(&cinfo);
-		return;
+		return(false);
 	}
 	
 	row_stride = cinfo.output_width * cinfo.output_components;
 	
-	while(cinfo.output_scanline < cinfo.output_height)
+	/* Convert the MCU range into a band of scanlines */
+	mcu_width = cinfo.max_h_samp_factor * DCTSIZE;
+	mcu_height = cinfo.max_v_samp_factor * DCTSIZE;
+	mcus_per_row = (cinfo.output_width + mcu_width - 1) / mcu_width;
+	
+	top = (mcu_start / mcus_per_row) * mcu_height;
+	bottom = ((mcu_end - 1) / mcus_per_row + 1) * mcu_height;
+	if(mcu_end <= 0 || bottom > cinfo.output_height) bottom = cinfo.output_height;
+	if(top >= bottom) top = 0;
+	
+	/* With fancy upsampling, the chroma of the rows next to the band is
+	 * interpolated from the first and last chroma rows of the band, so
+	 * those two rows change as well */
+	if(cinfo.do_fancy_upsampling)
 	{
-		uint8_t *b = &image[cinfo.output_scanline * row_stride];
+		if(top > 0) top--;
+		if(bottom < cinfo.output_height) bottom++;
+	}
+	
+#ifdef LIBJPEG_TURBO_VERSION_NUMBER
+	if(top > 0) jpeg_skip_scanlines(&cinfo, top);
+#else
+	while(cinfo.output_scanline < top)
+	{
+		uint8_t *b = &work_image[cinfo.output_scanline * row_stride];
+		jpeg_read_scanlines(&cinfo, &b, 1);
+	}
+#endif
+	
+	while(cinfo.output_scanline < bottom)
+	{
+		uint8_t *b = &work_image[cinfo.output_scanline * row_stride];
 		jpeg_read_scanlines(&cinfo, &b, 1);
 	}
 	
-	jpeg_finish_decompress(&cinfo);
+	/* The rest of the image is unchanged, stop here */
+	jpeg_abort_decompress(&cinfo);
 	jpeg_destroy_decompress(&cinfo);
+	
+	*y0 = top;
+	*y1 = bottom;
+	
+	return(true);
 }
 
@@ -125,6 +125,9 @@ void thor::reset_filters()
 	}
 //LOG_INFO("binsfft(%d) initialized", paths);
 
+	for (int i = 0; i < THORCWITESTS; i++)
+		cwivalid[i] = false;
+
 	for (int i = 0; i < THORSCOPESIZE; i++) {
 		if (vidfilter[i]) delete vidfilter[i];
 		vidfilter[i] = new Cmovavg(16);
@@ -289,6 +292,7 @@ thor::thor(trx_mode md) : hilbert(0), fft(0), filter_reset(false)
 	videodata.alloc(THORMAXFFTS * numbins );
 
 	pipeptr = 0;
+	pipepass = 0;
 
 	symcounter = 0;
 	metric = 0.0;
@@ -584,39 +588,63 @@ void thor::softdecodesymbol()
 	lastdoppler = nowdoppler;
 }
 
+// magnitudes of the bins of the current symbol, taken once for the symbol
+// decision, the sync scope and the s/n estimate
+void thor::binmags()
+{
+	const cmplx *v = pipe[pipeptr].vector;
+	for (int i = 0; i < paths * numbins; i++)
+		binmag[i] = abs(v[i]);
+}
+
+// magnitudes of the bins of pipe[j], they only change when the pipe
+// entry is rewritten, once every second symbol
+const double *thor::cwimags(int j)
+{
+	unsigned int pass = (unsigned int)j <= pipeptr ? pipepass : pipepass - 1;
+	double *mag = cwimag[j - 1];
+
+	if (!cwivalid[j - 1] || cwipass[j - 1] != pass) {
+		const cmplx *v = pipe[j].vector;
+		for (int i = 0; i < paths * numbins; i++)
+			mag[i] = abs(v[i]);
+		cwipass[j - 1] = pass;
+		cwivalid[j - 1] = true;
+	}
+	return mag;
+}
+
 int thor::harddecode()
 {
 	double x, max = 0.0;
 	int symbol = 0;
 	double avg = 0.0;
 	static bool cwi[MAXPATHS]; //[paths * numbins];
-	double cwmag;
+	const double *cwmag[THORCWITESTS];
 
 	for (int i = 0; i < MAXPATHS; i++) cwi[i] = false;
 
 	for (int i = 0; i < paths * numbins; i++)
-		avg += abs(pipe[pipeptr].vector[i]);
+		avg += binmag[i];
 	avg /= (paths * numbins);
 
 	if (avg < 1e-10) avg = 1e-10;
 
-	int numtests = 10;
-	int count = 0;
+	int numtests = THORCWITESTS;
+	double cwlevel = 50.0 * (1.0 - progdefaults.ThorCWI) * avg;
+	for (int j = 1; j <= numtests; j++)
+		cwmag[j - 1] = cwimags(j);
+// a bin is CWI when it is strong in all of the tested pipe entries
 	for (int i = 0; i < paths * numbins; i++) {
-		cwmag = 0.0;
-		count = 0;
-		for (int j = 1; j <= numtests; j++) {
-			int p = pipeptr - j;
-			if (p < 0) p += twosym;
-			cwmag = abs(pipe[j].vector[i])/numtests;
-			if (cwmag >= 50.0 * (1.0 - progdefaults.ThorCWI) * avg) count++;
-		}
-		cwi[i] = (count == numtests);
+		int j = 0;
+		while (j < numtests && cwmag[j][i] / numtests >= cwlevel)
+			j++;
+		cwi[i] = (j == numtests);
 	}
 
 	for (int i = 0; i <  paths * numbins ; i++) {
 		if (cwi[i] == false) {
-			x = abs(pipe[pipeptr].vector[i]);
+			x = binmag[i];
 			if (x > max) {
 				max = x;
 				symbol = i;
@@ -661,7 +689,7 @@ int thor::softdecode()
 	for (int i = lowest_tone; i < highest_tone; i++)
 	{
 		if ( !lastCWI[i]  ) {
-			avg += abs(pipe[pipeptr].vector[i]);
+			avg += binmag[i];
 			avgcount++;
 		}
 	}
@@ -675,7 +703,7 @@ int thor::softdecode()
 		max = 0.0;
 
 		for (int i = lowest_tone; i < highest_tone; i++) {
-		  	x = abs(pipe[pipeptr].vector[i]);
+		  	x = binmag[i];
 			if ( x > max && !nextCWI[i-1] && !nextCWI[i] && !nextCWI[i+1] ) {
 				max = x;
 				symbol = i;
@@ -758,14 +786,14 @@ void thor::update_syncscope()
 //LOG_INFO("%s", "cleared videodata");
 	if (!progStatus.sqlonoff || metric >= progStatus.sldrSquelchValue) {
 		for (int i = 0; i < paths * numbins; i++ ) {
-			mag = abs(pipe[pipeptr].vector[i]);
+			mag = binmag[i];
 			if (max < mag) max = mag;
 			if (min > mag) min = mag;
 		}
 		range = max - min;
 		for (int i = 0; i < paths * numbins; i++ ) {
 			if (range > 2) {
-				mag = (abs(pipe[pipeptr].vector[i]) - min) / range + 0.0001;
+				mag = (binmag[i] - min) / range + 0.0001;
 				mag = 1 + 2 * log10(mag);
 				if (mag < 0) mag = 0;
 			} else
@@ -819,7 +847,7 @@ void thor::synchronize()
 
 void thor::eval_s2n()
 {
-	double s = abs(pipe[pipeptr].vector[currsymbol]);
+	double s = binmag[currsymbol];
 	double n = (THORNUMTONES - 1) * 
 				abs( pipe[(pipeptr + symlen) % twosym].vector[currsymbol]);
 
@@ -904,13 +932,14 @@ int thor::rx_process(const double *buf, int len)
 				}
 				if (--synccounter <= 0) {
 					synccounter = symlen;
-					
+					binmags();
+
 					if (progdefaults.THOR_SOFTSYMBOLS) 
 						currsymbol = softdecode();
 					else 
 						currsymbol = harddecode();
 					
-					currmag = abs(pipe_pipeptr_vector[currsymbol]);
+					currmag = binmag[currsymbol];
 					eval_s2n();
 
 					if (progdefaults.THOR_SOFTBITS)
@@ -925,8 +954,10 @@ int thor::rx_process(const double *buf, int len)
 					prev1mag = currmag;
 				}
 				pipeptr++;
-				if (pipeptr >= twosym)
+				if (pipeptr >= twosym) {
 					pipeptr = 0;
+					pipepass++;
+				}
 			}
 		}
 		--len;
@@ -167,6 +167,22 @@ static const unsigned int thor_varidecode[] = {
 };
 static int limit = sizeof(thor_varidecode)/sizeof(unsigned int);
 
+// the extended decoding table indexed by the code, from 0xB80 up
+#define THOR_VARIDEC_FIRST 0xB80
+#define THOR_VARIDEC_CODES (0x1000 - THOR_VARIDEC_FIRST)
+
+static short thor_varidecode_index[THOR_VARIDEC_CODES];
+
+static bool thor_varidecode_index_init(void)
+{
+	for (int i = 0; i < THOR_VARIDEC_CODES; i++)
+		thor_varidecode_index[i] = -1;
+	for (int i = limit - 1; i >= 0; i--)
+		thor_varidecode_index[thor_varidecode[i] - THOR_VARIDEC_FIRST] = ' ' + i + 0x100;
+	return true;
+}
+static bool thor_varidecode_index_ok = thor_varidecode_index_init();
+
 const char *thorvarienc(int c, int sec)
 {
 	if (sec == 0)
@@ -180,15 +196,12 @@ const char *thorvarienc(int c, int sec)
 
 int thorvaridec(unsigned int symbol)
 {
-	int i;
-
-	if (symbol < 0xB80)
+	if (symbol < THOR_VARIDEC_FIRST)
 		return varidec(symbol);  // find in the MFSK decode table	
 
-	for (i = 0; i < limit; i++)
-		if (symbol == thor_varidecode[i])
-			return (' ' + i + 0x100);  // found in the extended decode table
-			
+	if (symbol - THOR_VARIDEC_FIRST < THOR_VARIDEC_CODES)
+		return thor_varidecode_index[symbol - THOR_VARIDEC_FIRST];  // extended decode table
+
 	return -1;                   // not found
 }
 
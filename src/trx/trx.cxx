@@ -40,7 +40,7 @@
 #include "dtmf.h"
 
 #include "soundconf.h"
-#include "ringbuffer.h"
+#include "bcastbuffer.h"
 #include "qrunner.h"
 #include "debug.h"
 #include "nullmodem.h"
@@ -75,14 +75,16 @@ cDTMF		*dtmf = 0;
 SoundBase 	*scard;
 static int	_trx_tune;
 
-// Ringbuffer for the audio "history". A pointer into this buffer
-// is also passed to the waterfall signal drawing routines.
+// Ringbuffer for the audio "history".  The trx thread is the only writer,
+// the waterfall drawing and the history replay read it with their own read
+// positions, so a reader that falls behind does not hold up the modem.
 #define NUMMEMBUFS 1024
-static ringbuffer<double> trxrb(ceil2(NUMMEMBUFS * SCBLOCKSIZE));
+static bcastbuffer<double> trxrb(ceil2(NUMMEMBUFS * SCBLOCKSIZE));
+static bcastbuffer<double>::reader wfreader(trxrb, bcastbuffer<double>::NEWEST);
 static float fbuf[SCBLOCKSIZE];
 bool    bHistory = false;
 bool    bHighSpeed = false;
-static  double hsbuff[SCBLOCKSIZE];
+static  double rxbuff[SCBLOCKSIZE];
 
 static bool trxrunning = false;
 
@@ -90,40 +92,15 @@ static bool trxrunning = false;
 
 //=============================================================================
 
-// Draws the xmit data one WFBLOCKSIZE-sized block at a time
-static void trx_xmit_wfall_draw(int samplerate)
+// Draws the rx or xmit data one WFBLOCKSIZE-sized block at a time
+static void trx_wfall_draw(int samplerate)
 {
 	ENSURE_THREAD(FLMAIN_TID);
 
-	ringbuffer<double>::vector_type rv[2];
-	rv[0].buf = 0;
-	rv[1].buf = 0;
-
-#define block_read_(vec_)						\
-	while (vec_.len >= WFBLOCKSIZE) {				\
-		wf->sig_data(vec_.buf, WFBLOCKSIZE, samplerate);	\
-		vec_.len -= WFBLOCKSIZE;				\
-		vec_.buf += WFBLOCKSIZE;				\
-		trxrb.read_advance(WFBLOCKSIZE);				\
-	}
-
-	trxrb.get_rv(rv);
-	block_read_(rv[0]); // read blocks from the first vector
-
-	if (rv[0].len + rv[1].len < WFBLOCKSIZE)
-		return;
-	if (rv[0].len == 0)
-		block_read_(rv[1]);
-#undef block_read_
-
-	// read non-contiguous data into tmp buffer so that we can
-	// still draw it one block at a time
-	if (unlikely(trxrb.read_space() >= WFBLOCKSIZE)) {
-		double buf[WFBLOCKSIZE];
-		do {
-			trxrb.read(buf, WFBLOCKSIZE);
-			wf->sig_data(buf, WFBLOCKSIZE, samplerate);
-		} while (trxrb.read_space() >= WFBLOCKSIZE);
+	double buf[WFBLOCKSIZE];
+	while (wfreader.read_space() >= WFBLOCKSIZE) {
+		wfreader.read(buf, WFBLOCKSIZE);
+		wf->sig_data(buf, WFBLOCKSIZE, samplerate);
 	}
 }
 
@@ -134,15 +111,14 @@ static void trx_xmit_wfall_end(int samplerate)
 {
 	ENSURE_THREAD(TRX_TID);
 
-	size_t pad = WFBLOCKSIZE - trxrb.read_space() % WFBLOCKSIZE;
+	size_t pad = WFBLOCKSIZE - trxrb.write_count() % WFBLOCKSIZE;
 	if (pad == WFBLOCKSIZE) // rb empty or multiple of WFBLOCKSIZE
 		return;
 
-	ringbuffer<double>::vector_type wv[2];
+	bcastbuffer<double>::vector_type wv[2];
 	wv[0].buf = wv[1].buf = 0;
 
 	trxrb.get_wv(wv, pad);
-	assert(wv[0].len + wv[1].len == pad);
 
 	if (likely(wv[0].len)) { // fill first vector, write rest to second vector
 		memset(wv[0].buf, 0, wv[0].len * sizeof(*wv[0].buf));
@@ -154,20 +130,18 @@ static void trx_xmit_wfall_end(int samplerate)
 
 	trxrb.write_advance(pad);
 
-	REQ(trx_xmit_wfall_draw, samplerate);
+	REQ(trx_wfall_draw, samplerate);
 }
 
-// Copy buf to the ringbuffer if it has enough space. Queue a waterfall
-// request whenever there are at least WFBLOCKSIZE samples to draw.
+// Copy buf to the ringbuffer. Queue a waterfall request whenever there
+// are at least WFBLOCKSIZE samples to draw.
 void trx_xmit_wfall_queue(int samplerate, const double* buf, size_t len)
 {
 	ENSURE_THREAD(TRX_TID);
-	ringbuffer<double>::vector_type wv[2];
+	bcastbuffer<double>::vector_type wv[2];
 	wv[0].buf = wv[1].buf = 0;
 
-	trxrb.get_wv(wv, len);
-	if (unlikely(wv[0].len + wv[1].len < len)) // not enough space
-		return;
+	len = trxrb.get_wv(wv, len);
 
 #define write_(vec_, len_)					\
 	for (size_t i = 0; i < len_; i++)			\
@@ -183,8 +157,8 @@ void trx_xmit_wfall_queue(int samplerate, const double* buf, size_t len)
 #undef write_
 
 	trxrb.write_advance(len);
-	if (trxrb.read_space() >= WFBLOCKSIZE)
-		REQ(trx_xmit_wfall_draw, samplerate);
+	if (trxrb.write_count() >= WFBLOCKSIZE)
+		REQ(trx_wfall_draw, samplerate);
 }
 
 //=============================================================================
@@ -201,8 +175,8 @@ void trx_trx_receive_loop()
 	}
 
 #if BENCHMARK_MODE
-	do_benchmark();
-	trx_state = STATE_ENDED;
+	if (!do_benchmark())
+		MilliSleep(10);
 	return;
 #endif
 
@@ -229,7 +203,7 @@ void trx_trx_receive_loop()
 	}
 	active_modem->rx_init();
 
-	ringbuffer<double>::vector_type rbvec[2];
+	bcastbuffer<double>::vector_type rbvec[2];
 	rbvec[0].buf = rbvec[1].buf = 0;
 
 	while (1) {
@@ -237,17 +211,8 @@ void trx_trx_receive_loop()
 			numread = 0;
 			while (numread < SCBLOCKSIZE && trx_state == STATE_RX) 
 				numread += scard->Read(fbuf + numread, SCBLOCKSIZE - numread);
-			if (bHighSpeed) {
-				for (size_t i = 0; i < numread; i++)
-					hsbuff[i] = fbuf[i];
-			} else {
-				if (trxrb.write_space() == 0) // discard some old data
-					trxrb.read_advance(SCBLOCKSIZE);
-				trxrb.get_wv(rbvec);
-			// convert to double and write to rb
-				for (size_t i = 0; i < numread; i++)
-					rbvec[0].buf[i] = fbuf[i];
-			}
+			for (size_t i = 0; i < numread; i++)
+				rxbuff[i] = fbuf[i];
 		}
 		catch (const SndException& e) {
 			scard->Close();
@@ -266,16 +231,17 @@ void trx_trx_receive_loop()
 			if (progdefaults.rsid)
 				ReedSolomon->receive(fbuf, numread);
 			active_modem->HistoryON(true);
-			active_modem->rx_process(hsbuff, numread);
+			active_modem->rx_process(rxbuff, numread);
 			QRUNNER_DROP(false);
 			progStatus.afconoff = afc;
 			active_modem->HistoryON(false);
 		} else {
-			trxrb.write_advance(numread);
-			REQ(&waterfall::sig_data, wf, rbvec[0].buf, numread, current_samplerate);
+		// the oldest data is overwritten when the buffer is full
+			trxrb.write(rxbuff, numread);
+			REQ(trx_wfall_draw, current_samplerate);
 
 			if (!bHistory) {
-				active_modem->rx_process(rbvec[0].buf, numread);
+				active_modem->rx_process(rxbuff, numread);
 				if (progdefaults.rsid)
 					ReedSolomon->receive(fbuf, numread);
 				dtmf->receive(fbuf, numread);
@@ -284,7 +250,9 @@ void trx_trx_receive_loop()
 				progStatus.afconoff = false;
 				QRUNNER_DROP(true);
 				active_modem->HistoryON(true);
-				trxrb.get_rv(rbvec);
+				bcastbuffer<double>::reader history(trxrb);
+				history.rewind();
+				history.get_rv(rbvec);
 				if (rbvec[0].len)
 					active_modem->rx_process(rbvec[0].buf, rbvec[0].len);
 				if (rbvec[1].len)
@@ -450,7 +418,7 @@ void *trx_loop(void *args)
 		if (unlikely(old_state != trx_state)) {
 			old_state = trx_state;
 			if (trx_state == STATE_TX || trx_state == STATE_TUNE)
-				trxrb.reset();
+				trxrb.discard();
 			trx_signal_state();
 		}
 
@@ -503,6 +471,9 @@ static int new_freq;
 
 void trx_start_modem_loop()
 {
+#if !BENCHMARK_MODE
+	ReedSolomon->flush_modem();
+#endif
 	if (new_modem == active_modem) {
 		if (new_freq > 0)
 			active_modem->set_freq(new_freq);
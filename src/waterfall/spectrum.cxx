@@ -0,0 +1,178 @@
+// ----------------------------------------------------------------------------
+// spectrum.cxx
+//
+// This file is part of fldigi.
+//
+// Fldigi is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Fldigi is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with fldigi.  If not, see <http://www.gnu.org/licenses/>.
+// ----------------------------------------------------------------------------
+
+#include <config.h>
+
+#include <algorithm>
+
+#include "spectrum.h"
+#include "util.h"
+
+spectrum::spectrum(int bins)
+	: nbins(bins), latest(0)
+{
+	log2tab = new int[nbins + 1];
+	log2tab[0] = log2tab[1] = 0;
+	for (int i = 2; i <= nbins; i++)
+		log2tab[i] = log2tab[i / 2] + 1;
+	nlevels = log2tab[nbins] + 1;
+
+	for (int n = 0; n < SPECTRUM_FRAMES; n++) {
+		frame &f = frames[n];
+		f.version = 0;
+		f.pwr = new double[nbins];
+		f.prefix = new double[nbins + 1];
+		f.max = new double*[nlevels];
+		f.max[0] = f.pwr;
+		for (int k = 1; k < nlevels; k++)
+			f.max[k] = new double[nbins - (1 << k) + 1];
+	}
+}
+
+spectrum::~spectrum()
+{
+	for (int n = 0; n < SPECTRUM_FRAMES; n++) {
+		frame &f = frames[n];
+		for (int k = 1; k < nlevels; k++)
+			delete [] f.max[k];
+		delete [] f.max;
+		delete [] f.prefix;
+		delete [] f.pwr;
+	}
+	delete [] log2tab;
+}
+
+template <typename T>
+void spectrum::publish_frame(const T *pwr)
+{
+	unsigned int v = latest + 1;
+	if (v == 0) // 0 marks a frame that is being written
+		v = 1;
+	frame &f = frames[v % SPECTRUM_FRAMES];
+
+	f.version = 0;
+	write_memory_barrier();
+
+	std::copy(pwr, pwr + nbins, f.pwr);
+
+	double s = 0.0;
+	f.prefix[0] = 0.0;
+	for (int i = 0; i < nbins; i++)
+		f.prefix[i + 1] = (s += f.pwr[i]);
+
+	for (int k = 1; k < nlevels; k++) {
+		const double *a = f.max[k - 1];
+		double *b = f.max[k];
+		int half = 1 << (k - 1);
+		int n = nbins - (1 << k) + 1;
+		for (int i = 0; i < n; i++)
+			b[i] = a[i] > a[i + half] ? a[i] : a[i + half];
+	}
+
+	write_memory_barrier();
+	f.version = v;
+	write_memory_barrier();
+	latest = v;
+}
+
+void spectrum::publish(const double *pwr)
+{
+	publish_frame(pwr);
+}
+
+void spectrum::publish(const float *pwr)
+{
+	publish_frame(pwr);
+}
+
+bool spectrum::clip(int &lo, int &hi)
+{
+	if (lo < 0) lo = 0;
+	if (hi > nbins - 1) hi = nbins - 1;
+	return lo <= hi;
+}
+
+spectrum::snapshot::snapshot(spectrum &s)
+	: spec(s)
+{
+	v = spec.latest;
+	read_memory_barrier();
+	f = v ? &spec.frames[v % SPECTRUM_FRAMES] : 0;
+}
+
+bool spectrum::snapshot::valid(void)
+{
+	if (!f)
+		return true;
+	read_memory_barrier();
+	return f->version == v;
+}
+
+double spectrum::snapshot::power(int i)
+{
+	if (!f || i < 1 || i >= spec.nbins)
+		return 0.0;
+	return f->pwr[i];
+}
+
+double spectrum::snapshot::sum(int lo, int hi)
+{
+	if (!f || !spec.clip(lo, hi))
+		return 0.0;
+	double s = f->prefix[hi + 1] - f->prefix[lo];
+	return s > 0.0 ? s : 0.0;
+}
+
+double spectrum::snapshot::peak(int lo, int hi)
+{
+	if (!f || !spec.clip(lo, hi))
+		return 0.0;
+	int k = spec.log2tab[hi - lo + 1];
+	double a = f->max[k][lo], b = f->max[k][hi - (1 << k) + 1];
+	return a > b ? a : b;
+}
+
+double spectrum::snapshot::density(double f0, double bw)
+{
+	int flower = (int)((f0 - bw/2)),
+		fupper = (int)((f0 + bw/2));
+	if (flower < 0 || fupper > spec.nbins)
+		return 0.0;
+	return sum(flower, fupper) / (bw + 1);
+}
+
+double spectrum::power(int i)
+{
+	for (;;) {
+		snapshot s(*this);
+		double p = s.power(i);
+		if (s.valid())
+			return p;
+	}
+}
+
+double spectrum::density(double f0, double bw)
+{
+	for (;;) {
+		snapshot s(*this);
+		double d = s.density(f0, bw);
+		if (s.valid())
+			return d;
+	}
+}
@@ -50,6 +50,7 @@
 #include "trx.h"
 #include "misc.h"
 #include "waterfall.h"
+#include "simd.h"
 #include "main.h"
 #include "modem.h"
 #include "qrunner.h"
@@ -111,8 +112,6 @@ static	RGB RGBred		= {254,0,0};
 RGBI	mag2RGBI[256];
 RGB		palette[9];
 
-short int *tmp_fft_db;
-
 WFdisp::WFdisp (int x0, int y0, int w0, int h0, char *lbl) :
 			  Fl_Widget(x0,y0,w0,h0,"") {
 	disp_width = w();
@@ -131,12 +130,13 @@ WFdisp::WFdisp (int x0, int y0, int w0, int h0, char *lbl) :
 	fft_sig_img 	= new uchar[image_area];
 	sig_img			= new uchar[sig_image_area];
 	pwr				= new wf_fft_type[IMAGE_WIDTH];
+	spec			= new spectrum(IMAGE_WIDTH);
 	fft_db			= new short int[image_area];
-	tmp_fft_db		= new short int[image_area];
 	circbuff		= new double[FFT_LEN];
 	wfbuf			= new wf_cpx_type[FFT_LEN];
 	wfft			= new g_fft<wf_fft_type>(FFT_LEN);
 	fftwindow		= new double[FFT_LEN];
+	wfwindow		= new double[FFT_LEN];
 	setPrefilter(progdefaults.wfPreFilter);
 
 	memset(circbuff, 0, FFT_LEN * sizeof(double));
@@ -177,6 +177,10 @@ WFdisp::WFdisp (int x0, int y0, int w0, int h0, char *lbl) :
 	tmp_carrier = false;
 	ptrCB = 0;
 	ptrFFTbuff = 0;
+	img_newrows = 0;
+	img_remap = true;
+	img_offset = img_step = img_width = 0;
+	img_averaging = false;
 
 	for (int i = 0; i < 256; i++)
 		mag2RGBI[i].I = mag2RGBI[i].R = mag2RGBI[i].G = mag2RGBI[i].B = 0;
@@ -190,9 +194,10 @@ WFdisp::~WFdisp() {
 	delete [] fft_sig_img;
 	delete [] sig_img;
 	delete [] pwr;
+	delete spec;
 	delete [] scline;
 	delete [] fft_db;
-	delete [] tmp_fft_db;
+	delete [] wfwindow;
 }
 
 void WFdisp::initMarkers() {
@@ -389,13 +394,14 @@ void WFdisp::setcolors() {
 			mag2RGBI[i + 32*n].B = b;
 		}
 	}
+	img_remap = true;
 }
 
 
 void WFdisp::initmaps() {
-	for (int i = 0; i < image_area; i++) fft_db[i] = tmp_fft_db[i] = log2disp(-1000);
+	short int v = log2disp(-1000);
+	for (int i = 0; i < image_area; i++) fft_db[i] = v;
 
-	memset (fft_img, 0, image_area * sizeof(RGBI) );
 	memset (scaleimage, 0, scale_width * WFSCALE);
 	memset (markerimage, 0, IMAGE_WIDTH * WFMARKER);
 	memset (fft_sig_img, 0, image_area);
@@ -405,6 +411,11 @@ void WFdisp::initmaps() {
 	initMarkers();
 	makeScale();
 	setcolors();
+
+// every fft_db row holds the same value, so is every mapped row
+	for (int i = 0; i < image_area; i++) fft_img[i] = mag2RGBI[v];
+	img_newrows = 0;
+	redraw();
 }
 
 int WFdisp::peakFreq(int f0, int delta)
@@ -430,51 +441,51 @@ int WFdisp::peakFreq(int f0, int delta)
 
 double WFdisp::powerDensity(double f0, double bw)
 {
-	double pwrdensity = 0.0;
-	int flower = (int)((f0 - bw/2)),
-		fupper = (int)((f0 + bw/2));
-	if (flower < 0 || fupper > IMAGE_WIDTH)
-		return 0.0;
-	for (int i = flower; i <= fupper; i++)
-		pwrdensity += pwr[i];
-	return pwrdensity/(bw+1);
+	return spec->density(f0, bw);
 }
 
 // Frequency of the maximum power for a given bandwidth. Used for AFC.
+// The whole search reads one spectrum frame, and is done again if the
+// waterfall reused that frame meanwhile.
 double WFdisp::powerDensityMaximum(int bw_nb, const int (*bw)[2]) const
 {
-	double max_pwr = 0 ;
 	int f_lowest = bw[0][0];
 	int f_highest = bw[bw_nb-1][1];
 	if( f_lowest > f_highest ) abort();
 
-	for( int i = 0 ; i < bw_nb; ++i )
-	{
-		const int * p_bw = bw[i];
-		if( p_bw[0] > p_bw[1] ) abort();
-		for( int j = p_bw[0] ; j <= p_bw[1]; ++j )
-		{
-			max_pwr += pwr[ j - f_lowest ];
-		}
-	}
+	for (;;) {
+		spectrum::snapshot s(*spec);
 
-	double curr_pwr = max_pwr ;
-	int max_idx = -1 ;
-	// Single pass to compute the maximum on this bandwidth.
-	for( int f = -f_lowest ; f < IMAGE_WIDTH - f_highest; ++f )
-	{
-		// Difference with previous power.
+		double max_pwr = 0 ;
 		for( int i = 0 ; i < bw_nb; ++i )
 		{
 			const int * p_bw = bw[i];
-			curr_pwr += pwr[ f + p_bw[1] ] - pwr[ f + p_bw[0] ];
+			if( p_bw[0] > p_bw[1] ) abort();
+			for( int j = p_bw[0] ; j <= p_bw[1]; ++j )
+			{
+				max_pwr += s.power( j - f_lowest );
+			}
 		}
-		if( curr_pwr > max_pwr ) {
-			max_idx = f ;
-			max_pwr = curr_pwr ;
+
+		double curr_pwr = max_pwr ;
+		int max_idx = -1 ;
+		// Single pass to compute the maximum on this bandwidth.
+		for( int f = -f_lowest ; f < IMAGE_WIDTH - f_highest; ++f )
+		{
+			// Difference with previous power.
+			for( int i = 0 ; i < bw_nb; ++i )
+			{
+				const int * p_bw = bw[i];
+				curr_pwr += s.power( f + p_bw[1] ) - s.power( f + p_bw[0] );
+			}
+			if( curr_pwr > max_pwr ) {
+				max_idx = f ;
+				max_pwr = curr_pwr ;
+			}
 		}
+		if (s.valid())
+			return max_idx ;
 	}
-	return max_idx ;
 }
 
 void WFdisp::setPrefilter(int v)
@@ -487,6 +498,19 @@ void WFdisp::setPrefilter(int v)
 	case WF_FFT_TRIANGULAR: TriangularWindow(fftwindow, FFT_LEN); break;
 	}
 	prefilter = v;
+	wfwindow_latency = 0;
+}
+
+// The fft input is the oldest FFT_LEN * latency / 16 samples of circbuff,
+// windowed with fftwindow stretched over that length and scaled.
+void WFdisp::setLatencyWindow(int latency)
+{
+	int nsamples = FFT_LEN * latency / 16;
+	double vscale = 2.0 / FFT_LEN * sqrt(16.0 / latency);
+
+	for (int i = 0; i < nsamples; i++)
+		wfwindow[i] = fftwindow[i * 16 / latency] * vscale;
+	wfwindow_latency = latency;
 }
 
 int WFdisp::log2disp(int v)
@@ -497,6 +521,64 @@ int WFdisp::log2disp(int v)
 	return (int)(255 - val);
 }
 
+//------------------------------------------------------------------------------
+// The display values of a row of power values, the same as
+//   log2disp(round(10.0 * log10(pwr[i] + 1e-10)))
+// The vector version takes log2 from the exponent bits and a short series
+// for the mantissa, which is good to about 1e-5 dB.  The dB values are
+// rounded one lane at a time, adding and subtracting 1.5 * 2^52 would be
+// folded away by -ffast-math.  It reads the bits of IEEE doubles, so it is
+// only used when wf_fft_type is double; other types use the scalar loop.
+//------------------------------------------------------------------------------
+template <typename T>
+static void pwr2disp(const T *pwr, short int *db, int n, int reflevel, int ampspan)
+{
+	for (int i = 0; i < n; i++) {
+		int ffth = round(10.0 * log10(pwr[i] + 1e-10) );
+		double val = 255.0 * (reflevel - ffth) / ampspan;
+		db[i] = val < 0 ? 255 : val > 255 ? 0 : (int)(255 - val);
+	}
+}
+
+#ifdef SIMD_VECTORS
+typedef double wf_v2d __attribute__((vector_size(16)));
+typedef long long wf_v2l __attribute__((vector_size(16)));
+
+// the exponent and mantissa masks below are those of a 64 bit double
+typedef char wf_v2d_check[sizeof(double) == 8 && sizeof(wf_v2d) == sizeof(wf_v2l) ? 1 : -1];
+
+static void pwr2disp(const double *pwr, short int *db, int n, int reflevel, int ampspan)
+{
+	// 2 / (k ln 2) for the atanh series of log2
+	static const double c1 = 2.8853900817779268, c3 = 0.9617966939259756,
+		c5 = 0.5770780163555854, c7 = 0.4121985831111324, c9 = 0.3205988979753252;
+	// 1.5 * 2^52, the exponent is added to its bits and it is subtracted
+	// as a double, which converts the integer without a rounding step
+	static const double rnd = 6755399441055744.0;
+	int i = 0;
+
+	for (; i + 2 <= n; i += 2) {
+		wf_v2d x;
+		__builtin_memcpy(&x, pwr + i, sizeof(x));
+		x = x + 1e-10;
+		wf_v2l bits = (wf_v2l)x;
+		wf_v2l e = (bits >> 52) - 1023;
+		wf_v2d ed = (wf_v2d)(e + (wf_v2l)(wf_v2d() + rnd)) - rnd;
+		wf_v2d m = (wf_v2d)((bits & 0x000fffffffffffffLL) | 0x3ff0000000000000LL);
+		wf_v2d t = (m - 1.0) / (m + 1.0);
+		wf_v2d t2 = t * t;
+		wf_v2d lg = ed + t * (c1 + t2 * (c3 + t2 * (c5 + t2 * (c7 + t2 * c9))));
+		wf_v2d h = lg * 3.0102999566398120;
+		for (int k = 0; k < 2; k++) {
+			int ffth = round(h[k]);
+			double val = 255.0 * (reflevel - ffth) / ampspan;
+			db[i + k] = val < 0 ? 255 : val > 255 ? 0 : (int)(255 - val);
+		}
+	}
+	pwr2disp<double>(pwr + i, db + i, n - i, reflevel, ampspan);
+}
+#endif
+
 void WFdisp::processFFT() {
 	if (prefilter != progdefaults.wfPreFilter)
 		setPrefilter(progdefaults.wfPreFilter);
@@ -505,19 +587,29 @@ void WFdisp::processFFT() {
 
 	if (--dispcnt == 0) {
 		static const int log2disp100 = log2disp(-100);
-		double vscale = 2.0 / FFT_LEN;
 
-		memset(wfbuf, 0, FFT_LEN * sizeof(*wfbuf));
 		void *pv = static_cast<void*>(wfbuf);
 		wf_fft_type *pbuf = static_cast<wf_fft_type*>(pv);
 
 		int latency = progdefaults.wf_latency;
 		if (latency < 1) latency = 1;
 		if (latency > 16) latency = 16;
+		if (latency != wfwindow_latency)
+			setLatencyWindow(latency);
 		int nsamples = FFT_LEN * latency / 16;
-		vscale *= sqrt(16.0 / latency);
-		for (int i = 0; i < nsamples; i++)
-			pbuf[i] = fftwindow[i * 16 / latency] * circbuff[i] * vscale;
+
+// the oldest samples of the ring, in two parts
+		int n1 = FFT_LEN - ptrCB;
+		if (n1 > nsamples) n1 = nsamples;
+		const double *w = wfwindow;
+		const double *c = circbuff + ptrCB;
+		for (int i = 0; i < n1; i++)
+			pbuf[i] = w[i] * c[i];
+		w += n1;
+		c = circbuff;
+		for (int i = n1; i < nsamples; i++)
+			pbuf[i] = *w++ * *c++;
+		memset(pbuf + nsamples, 0, (FFT_LEN - nsamples) * sizeof(*pbuf));
 
 		wfft->RealFFT(wfbuf);
 
@@ -526,23 +618,18 @@ void WFdisp::processFFT() {
 				log2disp100,
 				progdefaults.LowFreqCutoff * sizeof(*fft_db));
 
-		int n = 0;
-		for (int i = progdefaults.LowFreqCutoff + 1; i < IMAGE_WIDTH; i++) {
-			n = round(scale * i);
-			pwr[i] = norm(wfbuf[n]);
-			int ffth = round(10.0 * log10(pwr[i] + 1e-10) );
-			fft_db[ptrFFTbuff * IMAGE_WIDTH + i] = log2disp(ffth);
-		}
+		int lo = progdefaults.LowFreqCutoff + 1;
+		for (int i = lo; i < IMAGE_WIDTH; i++)
+			pwr[i] = norm(wfbuf[(int)round(scale * i)]);
+		pwr2disp(pwr + lo, &fft_db[ptrFFTbuff * IMAGE_WIDTH + lo],
+			 IMAGE_WIDTH - lo, reflevel, ampspan);
+		spec->publish(pwr);
 
 		ptrFFTbuff--;
 		if (ptrFFTbuff < 0) ptrFFTbuff += image_height;
+		if (img_newrows < image_height)
+			img_newrows++;
 
-		for (int i = 0; i < image_height; i++) {
-			int j = (i + 1 + ptrFFTbuff) % image_height;
-			memmove( (void *)(tmp_fft_db + i * IMAGE_WIDTH),
-					 (void *)(fft_db + j * IMAGE_WIDTH),
-					 IMAGE_WIDTH * sizeof(short int));
-		}
 		redraw();
 
 		if (srate == 8000)
@@ -555,7 +642,7 @@ void WFdisp::processFFT() {
 	}
 }
 
-void WFdisp::process_analog (wf_fft_type *sig, int len) {
+void WFdisp::process_analog (const double *sig, int len) {
 	int h1, h2, h3;
 	int sigy, sigpixel, ynext, graylevel;
 	h1 = h()/8 - 1;
@@ -604,12 +691,19 @@ void WFdisp::sig_data( double *sig, int len, int sr )
 		ptrCB = 0;
 	}
 
-	memmove((void*)circbuff,
-			(void*)(circbuff + len), 
-			(size_t)((FFT_LEN - len)*sizeof(wf_fft_type)));
-	memcpy((void*)&circbuff[FFT_LEN-len], 
-			(void*)sig,
-			(size_t)(len)*sizeof(double));
+	{
+		const double *p = sig;
+		int n = len;
+		if (n > FFT_LEN) {
+			p += n - FFT_LEN;
+			n = FFT_LEN;
+		}
+		int n1 = FFT_LEN - ptrCB;
+		if (n1 > n) n1 = n;
+		memcpy(circbuff + ptrCB, p, n1 * sizeof(double));
+		memcpy(circbuff, p + n1, (n - n1) * sizeof(double));
+		ptrCB = (ptrCB + n) % FFT_LEN;
+	}
 
 	{
 		overload = false;
@@ -819,29 +913,24 @@ void WFdisp::drawMarker() {
 		step * RGBsize, RGBwidth);
 }
 
-void WFdisp::update_waterfall() {
-// transfer the fft history data into the WF image
-	short int * __restrict__ p1, * __restrict__ p2;
-	RGBI * __restrict__ p3, * __restrict__ p4;
-	p1 = tmp_fft_db + offset + step/2;
-	p2 = p1;
-	p3 = fft_img;
-	p4 = p3;
+// map one row of the fft history into the WF image
+void WFdisp::map_row(int row)
+{
+	const short int * __restrict__ p2;
+	RGBI * __restrict__ p4;
+	p2 = fft_db + row * IMAGE_WIDTH + offset + step/2;
+	p4 = fft_img + row * IMAGE_WIDTH;
 
-	short*  __restrict__ limit = tmp_fft_db + image_area - step + 1;
+	const short* __restrict__ limit = fft_db + (row + 1) * IMAGE_WIDTH - step + 1;
 
 #define UPD_LOOP( Step, Operation ) \
-case Step: for (int row = 0; row < image_height; row++) { \
-		p2 = p1; \
-		p4 = p3; \
-		for ( const short *  __restrict__ last_p2 = std::min( p2 + Step * disp_width, limit +1 ); p2 < last_p2; p2 += Step ) { \
-			*(p4++) = mag2RGBI[ Operation ]; \
-		} \
-		p1 += IMAGE_WIDTH; \
-		p3 += disp_width; \
-	}; break
-
-	if (progdefaults.WFaveraging) {
+case Step: \
+	for ( const short *  __restrict__ last_p2 = std::min( p2 + Step * disp_width, limit +1 ); p2 < last_p2; p2 += Step ) { \
+		*(p4++) = mag2RGBI[ Operation ]; \
+	} \
+	break
+
+	if (img_averaging) {
 		switch(step) {
 			UPD_LOOP( 4, (*p2 + *(p2+1) + *(p2+2) + *(p2-1) + *(p2-1))/5 );
 			UPD_LOOP( 2, (*p2 + *(p2+1) + *(p2-1))/3 );
@@ -857,18 +946,73 @@ case Step: for (int row = 0; row < image_height; row++) { \
 		}
 	}
 #undef UPD_LOOP
+}
+
+// transfer the new fft history rows into the WF image, or all of them
+// when the frequency span or the colours have changed
+void WFdisp::update_waterfall() {
+	if (img_offset != offset || img_step != step || img_width != disp_width ||
+	    img_averaging != progdefaults.WFaveraging) {
+		img_offset = offset;
+		img_step = step;
+		img_width = disp_width;
+		img_averaging = progdefaults.WFaveraging;
+		img_remap = true;
+	}
+	if (img_remap) {
+		img_newrows = image_height;
+		img_remap = false;
+	}
+
+	int row = newest_row();
+	for (; img_newrows > 0; img_newrows--) {
+		map_row(row);
+		if (++row == image_height)
+			row = 0;
+	}
+}
+
+void WFdisp::drawcolorWF() {
+	static int waterwheel = 0;
+	FILE *fp;
+	png_structp png_ptr;
+	png_infop info_ptr;
+	png_bytep row_pointers[image_height];
+	png_byte tmp_image[image_height][w() * 3];
+
+	update_waterfall();
+
+	int x0 = x();
+	int y0 = y() + WFSCALE + WFMARKER + WFTEXT;
+	int top = newest_row();
 
+	fl_color(FL_BLACK);
+	fl_rectf(x(), y(), w(), WFSCALE + WFMARKER + WFTEXT);
+	fl_color(fl_rgb_color(palette[0].R, palette[0].G, palette[0].B));
+	fl_rectf(x0, y0, w(), image_height);
+// the ring is drawn in two parts, the newest row at the top
+	fl_draw_image(
+		(uchar *)(fft_img + top * IMAGE_WIDTH), x0, y0,
+		disp_width, image_height - top,
+		sizeof(RGBI), IMAGE_WIDTH * sizeof(RGBI) );
+	if (top)
+		fl_draw_image(
+			(uchar *)fft_img, x0, y0 + image_height - top,
+			disp_width, top,
+			sizeof(RGBI), IMAGE_WIDTH * sizeof(RGBI) );
+
+// the tracks, cursor and notch are drawn over the image
 	if (active_modem && progdefaults.UseBWTracks) {
 		int bw_lo = bandwidth / 2;
 		int bw_hi = bandwidth / 2;
 		trx_mode mode = active_modem->get_mode();
 		if (mode >= MODE_MT63_500S && mode <= MODE_MT63_2000L)
 			bw_hi = bw_hi * 31 / 32;
-		RGBI  *pos1 = fft_img + (carrierfreq - offset - bw_lo) / step;
-		RGBI  *pos2 = fft_img + (carrierfreq - offset + bw_hi) / step;
-		if (unlikely(pos2 == fft_img + disp_width))
+		int pos1 = (carrierfreq - offset - bw_lo) / step;
+		int pos2 = (carrierfreq - offset + bw_hi) / step;
+		if (unlikely(pos2 == disp_width))
 			pos2--;
-		if (likely(pos1 >= fft_img && pos2 < fft_img + disp_width)) {
+		if (likely(pos1 >= 0 && pos2 < disp_width)) {
 			RGBI rgbi1, rgbi2 ;
 
 			if (mode == MODE_RTTY && progdefaults.useMARKfreq) {
@@ -883,21 +1027,11 @@ case Step: for (int row = 0; row < image_height; row++) { \
 				rgbi1 = progdefaults.bwTrackRGBI;
 				rgbi2 = progdefaults.bwTrackRGBI;
 			}
-			if (progdefaults.UseWideTracks) {
-				for (int y = 0; y < image_height; y ++) {
-					*(pos1 + 1) = *pos1 = rgbi1;
-					*(pos2 - 1) = *pos2 = rgbi2;
-					pos1 += disp_width;
-					pos2 += disp_width;
-				}
-			} else {
-				for (int y = 0; y < image_height; y ++) {
-					*pos1 = rgbi1;
-					*pos2 = rgbi2;
-					pos1 += disp_width;
-					pos2 += disp_width;
-				}
-			}
+			int wide = progdefaults.UseWideTracks ? 2 : 1;
+			fl_color(fl_rgb_color(rgbi1.R, rgbi1.G, rgbi1.B));
+			fl_rectf(x0 + pos1, y0, wide, image_height);
+			fl_color(fl_rgb_color(rgbi2.R, rgbi2.G, rgbi2.B));
+			fl_rectf(x0 + pos2 - wide + 1, y0, wide, image_height);
 		}
 	}
 
@@ -907,28 +1041,15 @@ case Step: for (int row = 0; row < image_height; row++) { \
 		RGBInotch.R = progdefaults.notchRGBI.R;
 		RGBInotch.G = progdefaults.notchRGBI.G;
 		RGBInotch.B = progdefaults.notchRGBI.B;
-		RGBI  *notch = fft_img + (notch_frequency - offset) / step;
+		int notch = (notch_frequency - offset) / step;
+		fl_color(fl_rgb_color(RGBInotch.R, RGBInotch.G, RGBInotch.B));
 		int dash = 0;
 		for (int y = 0; y < image_height; y++) {
 			dash = (dash + 1) % 6;
 			if (dash == 0 || dash == 1 || dash == 2)
-				*(notch-1) = *notch = *(notch+1) = RGBInotch;
-			notch += disp_width;
+				fl_xyline(x0 + notch - 1, y0 + y, x0 + notch + 1);
 		}
 	}
-}
-
-void WFdisp::drawcolorWF() {
-	static int waterwheel = 0;
-	FILE *fp;
-	png_structp png_ptr;
-	png_infop info_ptr;
-	png_bytep row_pointers[image_height];
-	png_byte tmp_image[image_height][w() * 3];
-
-	uchar *pixmap = (uchar *)fft_img;
-
-	update_waterfall();
 
 	if (active_modem && wantcursor && 
 		(progdefaults.UseCursorLines || progdefaults.UseCursorCenterLine) ) {
@@ -937,35 +1058,28 @@ void WFdisp::drawcolorWF() {
 		int bw_hi = bandwidth / 2;
 		if (mode >= MODE_MT63_500S && mode <= MODE_MT63_2000L)
 			bw_hi = bw_hi * 31 / 32;
-		RGBI  *pos0 = (fft_img + cursorpos);
-		RGBI  *pos1 = (fft_img + cursorpos - bw_lo/step);
-		RGBI  *pos2 = (fft_img + cursorpos + bw_hi/step);
-		if (pos1 >= fft_img && pos2 < fft_img + disp_width)
-			for (int y = 0; y < image_height; y ++) {
-				if (progdefaults.UseCursorLines) {
-					*pos1 = *pos2 = progdefaults.cursorLineRGBI;
-					if (progdefaults.UseWideCursor)
-						*(pos1 + 1) = *(pos2 - 1) = *pos1;
-				}
-				if (progdefaults.UseCursorCenterLine) {
-					*pos0 = progdefaults.cursorCenterRGBI;
-					if (progdefaults.UseWideCenter)
-						*(pos0 - 1) = *(pos0 + 1) = *pos0;
-				}
-				pos0 += disp_width;
-				pos1 += disp_width;
-				pos2 += disp_width;
+		int pos0 = cursorpos;
+		int pos1 = cursorpos - bw_lo/step;
+		int pos2 = cursorpos + bw_hi/step;
+		if (pos1 >= 0 && pos2 < disp_width) {
+			if (progdefaults.UseCursorLines) {
+				RGBI c = progdefaults.cursorLineRGBI;
+				int wide = progdefaults.UseWideCursor ? 2 : 1;
+				fl_color(fl_rgb_color(c.R, c.G, c.B));
+				fl_rectf(x0 + pos1, y0, wide, image_height);
+				fl_rectf(x0 + pos2 - wide + 1, y0, wide, image_height);
 			}
+			if (progdefaults.UseCursorCenterLine) {
+				RGBI c = progdefaults.cursorCenterRGBI;
+				fl_color(fl_rgb_color(c.R, c.G, c.B));
+				if (progdefaults.UseWideCenter)
+					fl_rectf(x0 + pos0 - 1, y0, 3, image_height);
+				else
+					fl_rectf(x0 + pos0, y0, 1, image_height);
+			}
+		}
 	}
 
-	fl_color(FL_BLACK);
-	fl_rectf(x(), y(), w(), WFSCALE + WFMARKER + WFTEXT);
-	fl_color(fl_rgb_color(palette[0].R, palette[0].G, palette[0].B));
-	fl_rectf(x(), y() + WFSCALE + WFMARKER + WFTEXT, w(), image_height);
-	fl_draw_image(
-		pixmap, x(), y() + WFSCALE + WFMARKER + WFTEXT,
-		disp_width, image_height,
-		sizeof(RGBI), disp_width * sizeof(RGBI) );
 	drawScale();
 
 	if (waterwheel == 0)
@@ -1017,9 +1131,10 @@ void WFdisp::drawcolorWF() {
 			png_set_IHDR(png_ptr, info_ptr, disp_width, image_height, 8, PNG_COLOR_TYPE_RGB,
 					 PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
 
-			for (int y = 0; y < image_height; y++) for (int x = 0; x < disp_width; x++)
-			{
-				memcpy(&(tmp_image[y][x * 3]), pixmap + ((x + (y * disp_width)) * sizeof(RGBI)), 3);
+			for (int y = 0; y < image_height; y++) {
+				RGBI *row = fft_img + ((top + y) % image_height) * IMAGE_WIDTH;
+				for (int x = 0; x < disp_width; x++)
+					memcpy(&(tmp_image[y][x * 3]), row + x, 3);
 			}
 
 			for (int k = 0; k < image_height; k++)
@@ -1056,15 +1171,17 @@ void WFdisp::drawspectrum() {
 
 	memset (fft_sig_img, 0, image_area);
 
+	const short int *fft_line = fft_db + newest_row() * IMAGE_WIDTH;
+
 	fftpixel /= step;
 	for (int c = 0; c < IMAGE_WIDTH; c += step) {
-		sig = tmp_fft_db[c];
+		sig = fft_line[c];
 		if (step == 1)
-			sig = tmp_fft_db[c];
+			sig = fft_line[c];
 		else if (step == 2)
-			sig = MAX(tmp_fft_db[c], tmp_fft_db[c+1]);
+			sig = MAX(fft_line[c], fft_line[c+1]);
 		else
-			sig = MAX( MAX ( MAX ( tmp_fft_db[c], tmp_fft_db[c+1] ), tmp_fft_db[c+2] ), tmp_fft_db[c+3]);
+			sig = MAX( MAX ( MAX ( fft_line[c], fft_line[c+1] ), fft_line[c+2] ), fft_line[c+3]);
 		ynext = h1 * sig / 256;
 		while (ffty < ynext) { fft_sig_img[fftpixel -= IMAGE_WIDTH/step] = graylevel; ffty++;}
 		while (ffty > ynext) { fft_sig_img[fftpixel += IMAGE_WIDTH/step] = graylevel; ffty--;}
@@ -152,10 +152,18 @@ FTextRX::FTextRX(int x, int y, int w, int h, const char *l)
 	delete mVScrollBar;
 	Fl_Group::add(mVScrollBar = mvsb);
 	mFastDisplay = 1;
+
+	nlines = 0;
+	lw_len = 0;
+	lw_width = 0.0;
+	lw_font = textfont();
+	lw_size = textsize();
+	tbuf->add_modify_callback(count_lines_cb, this);
 }
 
 FTextRX::~FTextRX()
 {
+	tbuf->remove_modify_callback(count_lines_cb, this);
 }
 
 /// Handles fltk events for this widget.
@@ -251,57 +259,85 @@ out:
 
 void FTextRX::add(unsigned int c, int attr)
 {
-	if (c == '\r')
-		return;
+	char s = c;
+	add(&s, 1, attr);
+}
 
+/// Adds a run of characters to the buffer
+///
+/// Characters that neither end nor wrap the current line are inserted
+/// together, and the view is scrolled once for the whole run.
+///
+/// @param text The characters
+/// @param len The number of characters
+/// @param attr The attribute (@see enum text_attr_e)
+///
+void FTextRX::add(const char *text, size_t len, int attr)
+{
 	char s[] = { '\0', '\0', char( FTEXT_DEF + attr ), '\0' };
-	const char *cp = &s[0];
-
-	// The user may have moved the cursor by selecting text or
-	// scrolling. Place it at the end of the buffer.
-	if (mCursorPos != tbuf->length())
-		insert_position(tbuf->length());
-
-	switch (c) {
-	case '\b':
-		// we don't call kf_backspace because it kills selected text
-		if (s_text.length()) {
-			int character_start = tbuf->utf8_align(tbuf->length() - 1);
-			int character_length = fl_utf8len1(tbuf->byte_at(character_start));
-
-			tbuf->remove(character_start, tbuf->length());
-			sbuf->remove(character_start, sbuf->length());
-			s_text.resize(s_text.length() - character_length);
-			s_style.resize(s_style.length() - character_length);
-		}
-		break;
-	case '\n':
-		// maintain the scrollback limit, if we have one
-		if (max_lines > 0 && tbuf->count_lines(0, tbuf->length()) >= max_lines) {
-			int le = tbuf->line_end(0) + 1; // plus 1 for the newline
-			tbuf->remove(0, le);
-			sbuf->remove(0, le);
-		}
-		s_text.clear();
-		s_style.clear();
-		insert("\n");
-		sbuf->append(s + 2);
-		break;
-	default:
-		if ((c < ' ' || c == 127) && attr != CTRL) // look it up
-			cp = ascii[(unsigned char)c];
-		else  // insert verbatim
-			s[0] = c;
-
-		for (int i = 0; cp[i]; ++i) {
-			s_text += cp[i];
-			s_style += s[2];
-		}
+	string run, run_style;
+
+	for (size_t n = 0; n < len; n++) {
+		unsigned char c = text[n];
+		const char *cp = &s[0];
+
+		if (c == '\r')
+			continue;
+
+		// The user may have moved the cursor by selecting text or
+		// scrolling. Place it at the end of the buffer.
+		if (run.empty() && mCursorPos != tbuf->length())
+			insert_position(tbuf->length());
+
+		switch (c) {
+		case '\b':
+			insert_run(run, run_style);
+			// we don't call kf_backspace because it kills selected text
+			if (s_text.length()) {
+				int character_start = tbuf->utf8_align(tbuf->length() - 1);
+				int character_length = fl_utf8len1(tbuf->byte_at(character_start));
+
+				tbuf->remove(character_start, tbuf->length());
+				sbuf->remove(character_start, sbuf->length());
+				s_text.resize(s_text.length() - character_length);
+				s_style.resize(s_style.length() - character_length);
+				line_changed();
+			}
+			break;
+		case '\n':
+			insert_run(run, run_style);
+			// maintain the scrollback limit, if we have one
+			if (max_lines > 0 && nlines >= max_lines) {
+				int le = tbuf->line_end(0) + 1; // plus 1 for the newline
+				tbuf->remove(0, le);
+				sbuf->remove(0, le);
+			}
+			s_text.clear();
+			s_style.clear();
+			line_changed();
+			insert("\n");
+			sbuf->append(s + 2);
+			break;
+		default:
+			if ((c < ' ' || c == 127) && attr != CTRL) // look it up
+				cp = ascii[c];
+			else  // insert verbatim
+				s[0] = c;
+
+			for (int i = 0; cp[i]; ++i) {
+				s_text += cp[i];
+				s_style += s[2];
+			}
 
-		fl_font( textfont(), textsize() );
-		int lwidth = (int)fl_width( s_text.c_str(), s_text.length());
-		bool wrapped = false;
-		if ( lwidth >= (text_area.w - mVScrollBar->w() - LEFT_MARGIN - RIGHT_MARGIN)) {
+			if (line_width() < (text_area.w - mVScrollBar->w() - LEFT_MARGIN - RIGHT_MARGIN)) {
+				run += cp;
+				run_style.append(strlen(cp), s[2]);
+				break;
+			}
+
+			insert_run(run, run_style);
+			line_changed();
+			bool wrapped = false;
 			if (c != ' ') {
 				size_t p = s_text.rfind(' ');
 				if (p != string::npos) {
@@ -332,13 +368,10 @@ void FTextRX::add(unsigned int c, int attr)
 					insert(cp);
 				}
 			}
-		} else {
-			for (int i = 0; cp[i]; ++i)
-				sbuf->append(s + 2);
-			insert(cp);
+			break;
 		}
-		break;
 	}
+	insert_run(run, run_style);
 
 // test for bottom of text visibility
 	if (// !mFastDisplay && 
@@ -346,6 +379,62 @@ void FTextRX::add(unsigned int c, int attr)
 		show_insert_position();
 }
 
+/// Inserts characters collected by add, and their styles, at the end of
+/// the buffer
+void FTextRX::insert_run(string& text, string& style)
+{
+	if (text.empty())
+		return;
+	sbuf->append(style.c_str());
+	insert(text.c_str());
+	text.clear();
+	style.clear();
+}
+
+/// Returns the width of the current line
+///
+/// The width of the characters measured by earlier calls is kept, so that
+/// only the new characters are measured.  A partial UTF-8 character at the
+/// end of the line is left for the next call.
+int FTextRX::line_width(void)
+{
+	fl_font(textfont(), textsize());
+	if (lw_font != textfont() || lw_size != textsize() || lw_len > s_text.length()) {
+		lw_font = textfont();
+		lw_size = textsize();
+		line_changed();
+	}
+
+	size_t end = lw_len;
+	while (end < s_text.length()) {
+		int n = fl_utf8len1(s_text[end]);
+		if (n < 1)
+			n = 1;
+		if (end + n > s_text.length())
+			break;
+		end += n;
+	}
+	if (end > lw_len) {
+		lw_width += fl_width(s_text.data() + lw_len, end - lw_len);
+		lw_len = end;
+	}
+
+	return (int)lw_width;
+}
+
+/// Keeps the count of newlines in the text buffer for the scrollback limit
+void FTextRX::count_lines_cb(int pos, int nins, int ndel, int nsty, const char *dtext, void *arg)
+{
+	FTextRX* v = static_cast<FTextRX*>(arg);
+
+	for (int i = 0; i < ndel && dtext; i++)
+		if (dtext[i] == '\n')
+			v->nlines--;
+	for (int i = pos; i < pos + nins; i++)
+		if (v->tbuf->byte_at(i) == '\n')
+			v->nlines++;
+}
+
 void FTextRX::set_quick_entry(bool b)
 {
 	if (b)
@@ -375,6 +464,7 @@ void FTextRX::clear(void)
 	FTextBase::clear();
 	s_text.clear();
 	s_style.clear();
+	line_changed();
 	static_cast<MVScrollbar*>(mVScrollBar)->clear();
 }
 